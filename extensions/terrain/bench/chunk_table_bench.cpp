@@ -0,0 +1,315 @@
+// Contention benchmark for ChunkTable against the map it replaced, 32 shards of std::unordered_map behind
+// std::shared_mutex. Readers look up random chunks around the origin while writers unload and reload chunks in a band
+// around them, the way the loader streams chunks in and out as the viewer moves.
+// Usage: chunk_table_bench [seconds per run] [max reader threads] [writer threads]
+
+#include "chunk_table.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using godot::Vector3i;
+
+namespace
+{
+constexpr uint64_t SHARD_BITS = 5;
+constexpr uint64_t SHARD_COUNT = 1ULL << SHARD_BITS;
+// Loaded chunks are a cube of this radius, lookups go a bit past it so some of them miss
+constexpr int32_t LOADED_RADIUS = 16;
+constexpr int32_t LOOKUP_RADIUS = LOADED_RADIUS + 2;
+// Writers churn the outer shell of the cube
+constexpr int32_t CHURN_DEPTH = 2;
+
+struct Value
+{
+	Vector3i position{};
+};
+
+// The map before ChunkTable, kept here as the baseline
+struct Vector3iHasher
+{
+	uint64_t operator()(const Vector3i& v) const
+	{
+		uint64_t x = static_cast<uint64_t>(v.x);
+		uint64_t y = static_cast<uint64_t>(v.y);
+		uint64_t z = static_cast<uint64_t>(v.z);
+
+		uint64_t h = x * 73856093ULL;
+		h ^= y * 19349663ULL;
+		h ^= z * 83492791ULL;
+
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+};
+
+class ShardedMap
+{
+public:
+	static constexpr const char* NAME = "sharded unordered_map";
+
+	// Its locks keep readers safe, there's nothing to pin or reclaim
+	struct Pin
+	{
+	};
+	Pin pin() const { return {}; }
+	void reclaim() {}
+
+	Value* find(const Vector3i& p_pos) const
+	{
+		const Shard& shard = shards[get_shard(p_pos)];
+		std::shared_lock lock(shard.mutex);
+		auto it = shard.data.find(p_pos);
+		return it != shard.data.end() ? it->second : nullptr;
+	}
+
+	void insert(const Vector3i& p_pos, Value* p_value)
+	{
+		Shard& shard = shards[get_shard(p_pos)];
+		std::unique_lock lock(shard.mutex);
+		shard.data.try_emplace(p_pos, p_value);
+	}
+
+	Value* erase(const Vector3i& p_pos)
+	{
+		Shard& shard = shards[get_shard(p_pos)];
+		std::unique_lock lock(shard.mutex);
+		auto it = shard.data.find(p_pos);
+		if (it == shard.data.end())
+		{
+			return nullptr;
+		}
+		Value* value = it->second;
+		shard.data.erase(it);
+		return value;
+	}
+
+private:
+	struct Shard
+	{
+		std::unordered_map<Vector3i, Value*, Vector3iHasher> data;
+		mutable std::shared_mutex mutex;
+	};
+
+	static uint64_t get_shard(const Vector3i& p_pos) { return Vector3iHasher()(p_pos) & (SHARD_COUNT - 1); }
+
+	std::array<Shard, SHARD_COUNT> shards{};
+};
+
+// Sharded the same way ConcurrentChunkMap shards its tables
+class ShardedTable
+{
+public:
+	static constexpr const char* NAME = "sharded ChunkTable";
+
+	ShardedTable()
+	{
+		for (uint64_t shard_idx = 0; shard_idx < SHARD_COUNT; ++shard_idx)
+		{
+			tables.emplace_back(epochs);
+		}
+	}
+
+	EpochManager::Pin pin() const { return epochs.pin(); }
+
+	// Frees the arrays rebuilds left behind, as ConcurrentChunkMap::reclaim does
+	void reclaim()
+	{
+		epochs.try_advance();
+		for (ChunkTable<Value>& table : tables)
+		{
+			table.reclaim();
+		}
+	}
+
+	Value* find(const Vector3i& p_pos) const
+	{
+		const uint64_t key = chunk_key::pack(p_pos);
+		const uint64_t hash = chunk_key::hash(key);
+		return tables[get_shard(hash)].find(key, hash);
+	}
+
+	void insert(const Vector3i& p_pos, Value* p_value)
+	{
+		const uint64_t key = chunk_key::pack(p_pos);
+		const uint64_t hash = chunk_key::hash(key);
+		tables[get_shard(hash)].insert(key, hash, p_value);
+	}
+
+	Value* erase(const Vector3i& p_pos)
+	{
+		const uint64_t key = chunk_key::pack(p_pos);
+		const uint64_t hash = chunk_key::hash(key);
+		return tables[get_shard(hash)].erase(key, hash);
+	}
+
+private:
+	static uint64_t get_shard(uint64_t p_hash) { return p_hash >> (64 - SHARD_BITS); }
+
+	mutable EpochManager epochs{};
+	std::deque<ChunkTable<Value>> tables;
+};
+
+struct Result
+{
+	double reads_per_second = 0.0;
+	double writes_per_second = 0.0;
+	uint64_t wrong_reads = 0;
+};
+
+bool is_in_churn_band(const Vector3i& p_pos)
+{
+	const int32_t inner = LOADED_RADIUS - CHURN_DEPTH;
+	return std::abs(p_pos.x) > inner || std::abs(p_pos.y) > inner || std::abs(p_pos.z) > inner;
+}
+
+template <typename TMap>
+Result run(int64_t p_reader_count, int64_t p_writer_count, double p_seconds)
+{
+	TMap map;
+	std::vector<std::unique_ptr<Value>> values;
+	std::vector<std::vector<Vector3i>> churn_positions(p_writer_count);
+	for (int32_t z = -LOADED_RADIUS; z <= LOADED_RADIUS; ++z)
+	{
+		for (int32_t y = -LOADED_RADIUS; y <= LOADED_RADIUS; ++y)
+		{
+			for (int32_t x = -LOADED_RADIUS; x <= LOADED_RADIUS; ++x)
+			{
+				const Vector3i pos(x, y, z);
+				values.push_back(std::make_unique<Value>(Value{ pos }));
+				map.insert(pos, values.back().get());
+				if (p_writer_count > 0 && is_in_churn_band(pos))
+				{
+					// Each writer owns its own positions, so a value is never in the map twice
+					churn_positions[values.size() % p_writer_count].push_back(pos);
+				}
+			}
+		}
+	}
+
+	std::atomic<bool> is_running = true;
+	std::atomic<uint64_t> read_count = 0;
+	std::atomic<uint64_t> write_count = 0;
+	std::atomic<uint64_t> wrong_read_count = 0;
+	std::vector<std::thread> threads;
+
+	for (int64_t reader_index = 0; reader_index < p_reader_count; ++reader_index)
+	{
+		threads.emplace_back([&, reader_index]()
+				{
+					std::mt19937 rng(static_cast<uint32_t>(reader_index) + 1);
+					std::uniform_int_distribution<int32_t> axis(-LOOKUP_RADIUS, LOOKUP_RADIUS);
+					uint64_t reads = 0;
+					uint64_t wrong_reads = 0;
+					while (is_running.load(std::memory_order_relaxed))
+					{
+						[[maybe_unused]] const auto pin = map.pin();
+						for (int32_t i = 0; i < 256; ++i)
+						{
+							const Vector3i pos(axis(rng), axis(rng), axis(rng));
+							const Value* value = map.find(pos);
+							// Values are never freed during a run, a hit always has to be the right chunk
+							if (value && value->position != pos)
+							{
+								++wrong_reads;
+							}
+						}
+						reads += 256;
+					}
+					read_count += reads;
+					wrong_read_count += wrong_reads;
+				});
+	}
+
+	for (int64_t writer_index = 0; writer_index < p_writer_count; ++writer_index)
+	{
+		threads.emplace_back([&, writer_index]()
+				{
+					const std::vector<Vector3i>& positions = churn_positions[writer_index];
+					uint64_t writes = 0;
+					while (is_running.load(std::memory_order_relaxed) && !positions.empty())
+					{
+						// Unload a batch and load it back, like the viewer moving back and forth
+						constexpr uint64_t BATCH = 64;
+						const uint64_t start = (writes / 2) % positions.size();
+						const uint64_t end = std::min<uint64_t>(start + BATCH, positions.size());
+						std::vector<Value*> removed;
+						for (uint64_t i = start; i < end; ++i)
+						{
+							removed.push_back(map.erase(positions[i]));
+						}
+						for (uint64_t i = start; i < end; ++i)
+						{
+							map.insert(positions[i], removed[i - start]);
+						}
+						writes += 2 * (end - start);
+						if (writer_index == 0)
+						{
+							map.reclaim();
+						}
+					}
+					write_count += writes;
+				});
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(p_seconds));
+	is_running = false;
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	Result result{};
+	result.reads_per_second = read_count.load() / p_seconds;
+	result.writes_per_second = write_count.load() / p_seconds;
+	result.wrong_reads = wrong_read_count.load();
+	return result;
+}
+
+template <typename TMap>
+bool run_all(int64_t p_max_readers, int64_t p_writer_count, double p_seconds)
+{
+	bool is_correct = true;
+	std::printf("%s, %lld writer(s)\n", TMap::NAME, static_cast<long long>(p_writer_count));
+	std::printf("  readers   Mreads/s   Mreads/s/thread   Mwrites/s\n");
+	for (int64_t reader_count = 1; reader_count <= p_max_readers; reader_count *= 2)
+	{
+		const Result result = run<TMap>(reader_count, p_writer_count, p_seconds);
+		std::printf("  %7lld   %8.2f   %15.2f   %9.3f\n", static_cast<long long>(reader_count), result.reads_per_second / 1e6,
+				result.reads_per_second / 1e6 / reader_count, result.writes_per_second / 1e6);
+		if (result.wrong_reads > 0)
+		{
+			std::printf("  %llu reads returned the wrong chunk!\n", static_cast<unsigned long long>(result.wrong_reads));
+			is_correct = false;
+		}
+	}
+	return is_correct;
+}
+} //namespace
+
+int main(int argc, char** argv)
+{
+	const double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+	const int64_t max_readers = argc > 2 ? std::atoll(argv[2]) : std::max<int64_t>(1, std::thread::hardware_concurrency());
+	const int64_t writer_count = argc > 3 ? std::atoll(argv[3]) : 1;
+
+	bool is_correct = run_all<ShardedMap>(max_readers, writer_count, seconds);
+	is_correct &= run_all<ShardedTable>(max_readers, writer_count, seconds);
+	return is_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
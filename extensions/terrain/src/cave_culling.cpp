@@ -0,0 +1,108 @@
+#include "cave_culling.h"
+
+#include "chunk_data.h"
+#include "concurrent_chunk_map.h"
+#include "epoch_manager.h"
+#include "face_connectivity.h"
+#include "height_range_oracle.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+using namespace godot;
+using namespace face_connectivity;
+
+namespace
+{
+struct Step
+{
+	Vector3i chunk_pos{};
+	Face entry_face = FACE_COUNT; // FACE_COUNT for the origin, it can be left through any face
+	uint8_t travelled = 0; // Bit per face direction taken to get here
+};
+} //namespace
+
+void CaveCulling::update(ConcurrentChunkMap& p_chunk_map, const Vector3i& p_origin, int32_t p_radius, const HeightRangeOracle* p_oracle)
+{
+	const EpochManager::Pin pin = p_chunk_map.pin(); // Runs on a worker while chunks are unloaded
+	const int64_t radius_sq = static_cast<int64_t>(p_radius) * p_radius;
+
+	auto result = std::make_shared<ChunkSet>();
+	std::deque<Step> queue;
+
+	result->insert(p_origin);
+	queue.push_back(Step{ p_origin, FACE_COUNT, 0 });
+
+	while (!queue.empty())
+	{
+		const Step step = queue.front();
+		queue.pop_front();
+
+		uint16_t connectivity = ALL_CONNECTED;
+		if (const ChunkData* chunk = p_chunk_map.get_generated_chunk(step.chunk_pos))
+		{
+			connectivity = chunk->face_connectivity;
+		}
+		else if (p_oracle && p_oracle->classify(step.chunk_pos) == SurfaceState::FULL)
+		{
+			connectivity = NONE_CONNECTED; // Rock that's never loaded
+		}
+
+		for (int32_t i = 0; i < FACE_COUNT; ++i)
+		{
+			const Face exit_face = static_cast<Face>(i);
+
+			// Never head back towards the viewer
+			if (step.travelled & (1 << get_opposite(exit_face)))
+			{
+				continue;
+			}
+
+			if (step.entry_face != FACE_COUNT && !are_connected(connectivity, step.entry_face, exit_face))
+			{
+				continue;
+			}
+
+			const Vector3i next_pos = step.chunk_pos + get_direction(exit_face);
+			if ((next_pos - p_origin).length_squared() > radius_sq)
+			{
+				continue;
+			}
+
+			if (!result->insert(next_pos).second)
+			{
+				continue; // Already reached
+			}
+
+			queue.push_back(Step{ next_pos, get_opposite(exit_face), static_cast<uint8_t>(step.travelled | (1 << exit_face)) });
+		}
+	}
+
+	std::lock_guard lock(mutex);
+	reachable = std::move(result);
+	++result_id;
+}
+
+void CaveCulling::clear()
+{
+	std::lock_guard lock(mutex);
+	reachable.reset();
+	++result_id;
+}
+
+std::shared_ptr<const CaveCulling::ChunkSet> CaveCulling::get_reachable() const
+{
+	std::lock_guard lock(mutex);
+	return reachable;
+}
+
+uint64_t CaveCulling::get_result_id() const
+{
+	std::lock_guard lock(mutex);
+	return result_id;
+}
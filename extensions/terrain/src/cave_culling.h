@@ -0,0 +1,38 @@
+#pragma once
+
+#include "concurrent_chunk_map.h"
+#include "height_range_oracle.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+using namespace godot;
+
+/**
+ * @brief Finds the chunks that can be seen from the viewer through open space
+ * Breadth first search from the viewer's chunk, a chunk is only left through a face connected by air to the face it
+ * was entered from (see face_connectivity.h), and the search never turns back along an axis it already travelled.
+ * Chunks that aren't loaded yet count as open so they still get loaded, except the ones the HeightRangeOracle calls rock.
+ * update() runs on a worker thread, the result can be read from any thread.
+ */
+class CaveCulling
+{
+public:
+	using ChunkSet = std::unordered_set<Vector3i, Vector3iHasher>;
+
+	void update(ConcurrentChunkMap& p_chunk_map, const Vector3i& p_origin, int32_t p_radius, const HeightRangeOracle* p_oracle = nullptr);
+	void clear();
+
+	// Null until the first update has finished
+	std::shared_ptr<const ChunkSet> get_reachable() const;
+	uint64_t get_result_id() const;
+
+private:
+	mutable std::mutex mutex{};
+	std::shared_ptr<const ChunkSet> reachable{};
+	uint64_t result_id = 0;
+};
@@ -35,6 +35,8 @@ void Chunk::_ready()
 
 void Chunk::update_chunk_mesh(const MeshData& p_mesh_data)
 {
+	array_mesh = p_mesh_data.array_mesh;
+
 	if (mesh_instance)
 	{
 		bool has_mesh = p_mesh_data.array_mesh.is_valid();
@@ -52,28 +54,30 @@ void Chunk::update_chunk_mesh(const MeshData& p_mesh_data)
 
 void Chunk::update_chunk_collision(const CollisionData& p_collision_data)
 {
-	if (static_body && collision_shape)
+	if (!collision_shape)
 	{
-		Node* parent = static_body->get_parent();
-		if (parent)
-		{
-			parent->remove_child(static_body);
-		}
-		// Disable before setting the shape
-		collision_shape->set_disabled(true);
-		if (p_collision_data.collision_shape.is_valid())
-		{
-			collision_shape->set_shape(p_collision_data.collision_shape);
-			collision_shape->set_disabled(false);
-		}
-		else
-		{
-			collision_shape->set_shape(nullptr);
-		}
-		if (parent)
-		{
-			parent->add_child(static_body);
-		}
+		return;
+	}
+
+	// Setting the shape replaces it on the body in place, the body stays in the physics space
+	concave_shape = p_collision_data.collision_shape;
+	const bool has_shape = concave_shape.is_valid();
+	collision_shape->set_shape(concave_shape);
+	collision_shape->set_disabled(!has_shape);
+}
+
+void Chunk::reset()
+{
+	update_chunk_mesh(MeshData{});
+	update_chunk_collision(CollisionData{});
+	set_visible(false);
+}
+
+void Chunk::set_mesh_visible(bool p_visible)
+{
+	if (mesh_instance)
+	{
+		mesh_instance->set_visible(p_visible && array_mesh.is_valid());
 	}
 }
 
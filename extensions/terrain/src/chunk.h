@@ -2,7 +2,9 @@
 
 #include "mesh_generator.h"
 
+#include <godot_cpp/classes/array_mesh.hpp>
 #include <godot_cpp/classes/collision_shape3d.hpp>
+#include <godot_cpp/classes/concave_polygon_shape3d.hpp>
 #include <godot_cpp/classes/mesh_instance3d.hpp>
 #include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/classes/ref.hpp>
@@ -23,6 +25,15 @@ public:
 	void update_chunk_mesh(const MeshData& p_mesh_data);
 	void update_chunk_collision(const CollisionData& p_collision_data);
 	void set_material(Ref<StandardMaterial3D> p_material);
+	// Hides the mesh while it's drawn as part of a region mesh
+	void set_mesh_visible(bool p_visible);
+
+	Ref<ArrayMesh> get_mesh() const { return array_mesh; }
+	Ref<ConcavePolygonShape3D> get_collision_shape() const { return concave_shape; }
+	bool has_collision() const { return concave_shape.is_valid(); }
+
+	// Clears the mesh and collision and hides the chunk, so it can be recycled
+	void reset();
 
 protected:
 	static void _bind_methods() {};
@@ -31,4 +42,7 @@ private:
 	MeshInstance3D* mesh_instance;
 	StaticBody3D* static_body;
 	CollisionShape3D* collision_shape;
+
+	Ref<ArrayMesh> array_mesh;
+	Ref<ConcavePolygonShape3D> concave_shape;
 };
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "epoch_manager.h"
+#include "face_connectivity.h"
 #include "safe_pool.h"
 #include "terrain_constants.h"
 
 #include <godot_cpp/variant/vector3i.hpp>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 
 using namespace godot;
@@ -23,6 +26,52 @@ struct alignas(64) ChunkData
 	Vector3i position{};
 	int surface_sum{0};
 	SurfaceState surface_state = SurfaceState::EMPTY;
+	uint16_t face_connectivity = face_connectivity::ALL_CONNECTED; // See face_connectivity.h
+	// Never reused, every chunk the map creates or publishes gets a new one. Stamped into what's built from it, see
+	// ConcurrentChunkMap::is_current
+	uint64_t version = 0;
+	bool is_dirty = false; // In the dirty list, guarded by the map's dirty mutex
+	// Set by the generator once the points are written, after that a chunk in the map is never written to again.
+	// Edits copy it, see ConcurrentChunkMap::acquire_snapshot
+	std::atomic<bool> is_generated = false;
 };
 
+// Copies what a snapshot takes from the chunk it replaces, the flags are left alone
+inline void copy_chunk_contents(ChunkData& r_chunk_data, const ChunkData& p_source)
+{
+	r_chunk_data.points = p_source.points;
+	r_chunk_data.position = p_source.position;
+	r_chunk_data.surface_sum = p_source.surface_sum;
+	r_chunk_data.surface_state = p_source.surface_state;
+	r_chunk_data.face_connectivity = p_source.face_connectivity;
+}
+
+// Sets surface_state and face_connectivity from surface_sum, after the points were generated or edited
+inline void update_surface_state(ChunkData& r_chunk_data)
+{
+	if (r_chunk_data.surface_sum == 0)
+	{
+		r_chunk_data.surface_state = SurfaceState::EMPTY;
+		r_chunk_data.face_connectivity = face_connectivity::ALL_CONNECTED;
+	}
+	else if (r_chunk_data.surface_sum == terrain_constants::POINTS_VOLUME * 255)
+	{
+		r_chunk_data.surface_state = SurfaceState::FULL;
+		r_chunk_data.face_connectivity = face_connectivity::NONE_CONNECTED;
+	}
+	else
+	{
+		r_chunk_data.surface_state = SurfaceState::MIXED;
+		r_chunk_data.face_connectivity = face_connectivity::compute(r_chunk_data.points.data());
+	}
+}
+
 using ChunkPtr = SafePool<ChunkData>::Ptr;
+
+// A chunk queued for a worker. Queued by position and version rather than pointer, so a task waiting in a queue holds
+// no pin and doesn't hold up reclaiming. The worker pins and looks it up when it starts, see ConcurrentChunkMap::get_current
+struct ChunkTask
+{
+	Vector3i position{};
+	uint64_t version = 0;
+};
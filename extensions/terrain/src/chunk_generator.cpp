@@ -1,6 +1,8 @@
 #include "chunk_generator.h"
 
 #include "chunk_data.h"
+#include "concurrent_chunk_map.h"
+#include "face_connectivity.h"
 #include "terrain_constants.h"
 
 #include <godot_cpp/classes/fast_noise_lite.hpp>
@@ -42,8 +44,15 @@ void ChunkGeneratorSettings::_bind_methods()
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "height_multiplier_noise", PROPERTY_HINT_RESOURCE_TYPE, "FastNoiseLite"), "set_height_multiplier_noise", "get_height_multiplier_noise");
 }
 
-ChunkData* ChunkGenerator::process_task(ChunkData* chunk_data)
+ChunkTask ChunkGenerator::process_task(ChunkTask p_task)
 {
+	const EpochManager::Pin pin = chunk_map->pin();
+	ChunkData* chunk_data = chunk_map->get_current(p_task.position, p_task.version);
+	if (!chunk_data)
+	{
+		return p_task; // Unloaded while it was queued
+	}
+
 	// NOTE: this currently generates a chunk size + 1 array, but a chunk only needs the chunk size data and the extra data can be added before it's sent to the shader
 
 	chunk_data->surface_sum = 0;
@@ -53,7 +62,9 @@ ChunkData* ChunkGenerator::process_task(ChunkData* chunk_data)
 	if (!did_generate_height_map)
 	{
 		chunk_data->surface_state = SurfaceState::EMPTY;
-		return chunk_data;
+		chunk_data->face_connectivity = face_connectivity::ALL_CONNECTED;
+		chunk_data->is_generated.store(true, std::memory_order_release);
+		return p_task;
 	}
 	const float* height_map_ptr = tl_height_map->data.data();
 	uint8_t* points_ptr = chunk_data->points.data();
@@ -82,20 +93,10 @@ ChunkData* ChunkGenerator::process_task(ChunkData* chunk_data)
 		}
 	}
 
-	if (chunk_data->surface_sum == 0)
-	{
-		chunk_data->surface_state = SurfaceState::EMPTY;
-	}
-	else if (chunk_data->surface_sum == POINTS_VOLUME)
-	{
-		chunk_data->surface_state = SurfaceState::FULL;
-	}
-	else
-	{
-		chunk_data->surface_state = SurfaceState::MIXED;
-	}
+	update_surface_state(*chunk_data);
+	chunk_data->is_generated.store(true, std::memory_order_release);
 
-	return chunk_data;
+	return p_task;
 }
 
 thread_local float ChunkGenerator::uint8_to_float[256];
@@ -15,9 +15,12 @@
 
 #include <array>
 #include <list>
+#include <memory>
 
 using namespace godot;
 
+class ConcurrentChunkMap;
+
 // At 256 the uses over 1MiB per thread
 constexpr int HEIGHT_MAP_CACHE_PER_THREAD = 256;
 
@@ -53,7 +56,7 @@ protected:
 	void set_height_multiplier_noise(Ref<FastNoiseLite> p_height_multiplier_noise) { height_multiplier_noise = p_height_multiplier_noise; }
 };
 
-class ChunkGenerator final : public ITaskProcessor<ChunkData*, ChunkData*>
+class ChunkGenerator final : public ITaskProcessor<ChunkTask, ChunkTask>
 {
 	GDCLASS(ChunkGenerator, RefCounted)
 
@@ -61,10 +64,12 @@ public:
 	ChunkGenerator() = default;
 	virtual ~ChunkGenerator() = default;
 
-	static Ref<ChunkGenerator> create(Ref<ChunkGeneratorSettings> p_settings)
+	// The chunks are looked up in p_chunk_map when their task starts, ones unloaded while they were queued are skipped
+	static Ref<ChunkGenerator> create(Ref<ChunkGeneratorSettings> p_settings, std::shared_ptr<const ConcurrentChunkMap> p_chunk_map)
 	{
 		Ref<ChunkGenerator> chunk_generator = memnew((ChunkGenerator));
 		chunk_generator->settings = p_settings->duplicate(true);
+		chunk_generator->chunk_map = std::move(p_chunk_map);
 
 		for (int i = 0; i < 256; ++i)
 		{
@@ -74,7 +79,8 @@ public:
 		return chunk_generator;
 	}
 
-	virtual ChunkData* process_task(ChunkData* chunk_data) override;
+	// Returns the task, the results are looked up again by whoever takes them
+	virtual ChunkTask process_task(ChunkTask p_task) override;
 
 protected:
 	static void _bind_methods() {}
@@ -84,6 +90,7 @@ private:
 	bool generate_height_map(const Vector3& p_chunk_world_pos) const;
 
 	Ref<ChunkGeneratorSettings> settings;
+	std::shared_ptr<const ConcurrentChunkMap> chunk_map;
 	struct alignas(64) HeightMap
 	{
 		Vector2i position;
@@ -0,0 +1,703 @@
+#include "chunk_interest.h"
+
+#include "chunk_shells.h"
+#include "chunk_viewer.h"
+#include "concurrent_chunk_map.h"
+#include "delta_slabs.h"
+#include "height_range_oracle.h"
+#include "occupancy_grid.h"
+#include "terrain_constants.h"
+
+#include <godot_cpp/core/object.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace godot;
+using namespace terrain_constants;
+using chunk_shells::MIN_RADIUS;
+// Offsets of whole sphere jobs processed per update
+constexpr uint64_t JOB_OFFSETS_PER_UPDATE = 32768;
+// Moves longer than this many steps swap the whole sphere instead of walking the slabs
+constexpr int32_t MAX_MOVE_STEPS = 4;
+// Past this the entering chunks are dropped and the sphere is rebuilt from the chunk map
+constexpr uint64_t MAX_ENTERING_CHUNKS = 16384;
+// At most this many missing chunks are weighed per requested chunk, for each anchor
+constexpr uint64_t CANDIDATES_PER_CHUNK = 8;
+// Slower than this, in chunks per second, nothing is prefetched
+constexpr float MIN_PREFETCH_SPEED = 0.5f;
+// The acceleration is only followed this far into the prediction, after that the velocity is kept
+constexpr float MAX_ACCELERATION_SECONDS = 1.0f;
+// Caps on the predicted path and the chunks prefetched along it, per anchor
+constexpr uint64_t MAX_PREFETCH_STEPS = 64;
+constexpr uint64_t MAX_PREFETCH_CHUNKS = 16384;
+
+static uint32_t get_last_shell(int32_t p_radius)
+{
+	return static_cast<uint32_t>(p_radius - MIN_RADIUS);
+}
+
+void ChunkInterest::add_viewer(ChunkViewer* p_viewer)
+{
+	if (!p_viewer)
+	{
+		return;
+	}
+
+	const uint64_t object_id = p_viewer->get_instance_id();
+	for (const Viewer& viewer : viewers)
+	{
+		if (viewer.object_id == object_id)
+		{
+			return;
+		}
+	}
+
+	// It gets an anchor on the next update
+	Viewer viewer{};
+	viewer.object_id = object_id;
+	viewers.push_back(viewer);
+}
+
+void ChunkInterest::remove_viewer(ChunkViewer* p_viewer)
+{
+	if (!p_viewer)
+	{
+		return;
+	}
+
+	const uint64_t object_id = p_viewer->get_instance_id();
+	for (auto it = viewers.begin(); it != viewers.end(); ++it)
+	{
+		if (it->object_id == object_id)
+		{
+			if (it->has_anchor)
+			{
+				detach(it->anchor_id);
+			}
+			viewers.erase(it);
+			return;
+		}
+	}
+}
+
+void ChunkInterest::clear()
+{
+	{
+		std::lock_guard lock(anchor_mutex);
+		anchors.clear();
+	}
+	viewers.clear();
+	jobs.clear();
+	references.clear();
+	release_candidates.clear();
+}
+
+void ChunkInterest::reset_cursors()
+{
+	std::lock_guard lock(anchor_mutex);
+	for (Anchor& anchor : anchors)
+	{
+		anchor.current_shell = 0;
+		anchor.entering.clear();
+		anchor.missing_entering.clear();
+		anchor.is_occupancy_valid = false;
+		anchor.prefetch_cursor = 0;
+		++anchor.revision;
+	}
+}
+
+void ChunkInterest::update(std::vector<Vector3i>& r_released)
+{
+	for (auto it = viewers.begin(); it != viewers.end();)
+	{
+		ChunkViewer* viewer = Object::cast_to<ChunkViewer>(ObjectDB::get_instance(it->object_id));
+		if (!viewer)
+		{
+			// The viewer was freed without being removed
+			if (it->has_anchor)
+			{
+				detach(it->anchor_id);
+			}
+			it = viewers.erase(it);
+			continue;
+		}
+
+		if (!viewer->is_inside_tree())
+		{
+			++it; // Keeps its chunks where it left them
+			continue;
+		}
+
+		const Vector3i chunk_pos = viewer->get_current_chunk_pos();
+		const int32_t radius = get_radius(*viewer);
+		const chunk_shells::Shape shape = get_shape(*viewer);
+
+		Anchor* anchor = it->has_anchor ? find_anchor(it->anchor_id) : nullptr;
+		if (!anchor || anchor->chunk_pos != chunk_pos || anchor->radius != radius || anchor->shape != shape)
+		{
+			bool is_shared = false;
+			for (const Anchor& other : anchors)
+			{
+				is_shared |= other.chunk_pos == chunk_pos && other.radius == radius && other.shape == shape;
+			}
+
+			if (anchor && !is_shared && anchor->viewer_count == 1 && anchor->radius == radius && anchor->shape == shape)
+			{
+				move_anchor(*anchor, chunk_pos);
+			}
+			else
+			{
+				if (it->has_anchor)
+				{
+					detach(it->anchor_id);
+				}
+				it->anchor_id = attach(chunk_pos, radius, shape);
+				it->has_anchor = true;
+				anchor = find_anchor(it->anchor_id);
+			}
+		}
+
+		{
+			std::lock_guard lock(anchor_mutex);
+			anchor->view = viewer->get_view();
+			anchor->view.chunk_pos = anchor->chunk_pos;
+		}
+		++it;
+	}
+
+	// Once every viewer is in, shared anchors would otherwise predict from each of their viewers in turn
+	for (Anchor& anchor : anchors)
+	{
+		update_prefetch(anchor);
+	}
+
+	process_jobs();
+
+	if (!jobs.empty())
+	{
+		return; // Counts can still be off, so nothing is released yet
+	}
+
+	for (const Vector3i& chunk_pos : release_candidates)
+	{
+		auto it = references.find(chunk_pos);
+		if (it != references.end() && it->second <= 0)
+		{
+			references.erase(it);
+			r_released.push_back(chunk_pos);
+		}
+	}
+	release_candidates.clear();
+}
+
+std::vector<Vector3i> ChunkInterest::get_chunk_positions(ConcurrentChunkMap& p_chunk_map, int64_t p_max_count, const HeightRangeOracle* p_oracle)
+{
+	std::lock_guard cursor_lock(cursor_mutex);
+
+	std::vector<Anchor> anchors_snapshot;
+	{
+		std::lock_guard lock(anchor_mutex);
+		anchors_snapshot = anchors;
+	}
+
+	std::unordered_map<Vector3i, float, Vector3iHasher> candidates{};
+	const uint64_t max_candidates = p_max_count * CANDIDATES_PER_CHUNK;
+
+	// Looked up in batches
+	std::vector<Vector3i> lookup_positions{};
+	std::vector<uint8_t> is_loaded{};
+
+	// Uniform chunks are never created, they count as loaded
+	auto is_uniform = [p_oracle](const Vector3i& p_chunk_pos)
+	{ return p_oracle && p_oracle->is_uniform(p_chunk_pos); };
+
+	for (Anchor& anchor : anchors_snapshot)
+	{
+		OccupancyGrid& occupancy = *anchor.occupancy;
+		const chunk_shells::Shells& shells = chunk_shells::get_shells(anchor.shape);
+
+		if (!anchor.is_occupancy_valid)
+		{
+			// New, teleported or reset, the only time the whole sphere goes through the chunk map
+			occupancy.clear();
+			const uint32_t sphere_end = shells.get_end(anchor.radius);
+			lookup_positions.clear();
+			for (uint32_t i = 0; i < sphere_end; ++i)
+			{
+				lookup_positions.push_back(anchor.chunk_pos + shells.offsets[i]);
+			}
+			p_chunk_map.contains_many(lookup_positions, is_loaded);
+			for (uint64_t i = 0; i < lookup_positions.size(); ++i)
+			{
+				if (is_loaded[i])
+				{
+					occupancy.set(lookup_positions[i]);
+				}
+			}
+			anchor.is_occupancy_valid = true;
+			anchor.entering.clear();
+			anchor.missing_entering.clear();
+		}
+
+		// Entering chunks reuse the slots of the chunks that left, so only those go through the chunk map
+		std::erase_if(anchor.entering, [&](const Vector3i& chunk_pos)
+				{ return !shells.contains(chunk_pos - anchor.chunk_pos, anchor.radius); }); // Already left again
+		p_chunk_map.contains_many(anchor.entering, is_loaded);
+		for (uint64_t i = 0; i < anchor.entering.size(); ++i)
+		{
+			const Vector3i& chunk_pos = anchor.entering[i];
+			const bool is_present = is_loaded[i] || is_uniform(chunk_pos);
+			occupancy.set(chunk_pos, is_present);
+			if (!is_present)
+			{
+				anchor.missing_entering.push_back(chunk_pos);
+			}
+		}
+		anchor.entering.clear();
+
+		std::erase_if(anchor.missing_entering, [&](const Vector3i& chunk_pos)
+				{ return !shells.contains(chunk_pos - anchor.chunk_pos, anchor.radius) || occupancy.test(chunk_pos); });
+		for (const Vector3i& chunk_pos : anchor.missing_entering)
+		{
+			const float weight = anchor.view.get_chunk_weight(chunk_pos);
+			auto [it, is_inserted] = candidates.try_emplace(chunk_pos, weight);
+			if (!is_inserted)
+			{
+				it->second = std::min(it->second, weight);
+			}
+		}
+
+		const uint32_t last_shell = get_last_shell(anchor.radius);
+		if (anchor.current_shell <= last_shell && occupancy.count_missing(anchor.chunk_pos, anchor.radius, shells.vertical_scale) == 0)
+		{
+			anchor.current_shell = last_shell + 1; // Nothing missing, skip walking the shells
+		}
+
+		uint64_t anchor_candidate_count = 0;
+		// A chunk behind the camera can lose to chunks up to behind_camera_penalty times further away, so those shells are weighed too
+		float max_shell_radius = -1.0f;
+
+		for (uint32_t shell = anchor.current_shell; shell <= last_shell && anchor_candidate_count < max_candidates; ++shell)
+		{
+			const chunk_shells::ShellRange range = shells.ranges[shell];
+			const float shell_radius = static_cast<float>(shell + MIN_RADIUS);
+			if (max_shell_radius >= 0.0f && shell_radius > max_shell_radius)
+			{
+				break;
+			}
+
+			for (uint32_t i = range.start; i < range.end && anchor_candidate_count < max_candidates; ++i)
+			{
+				const Vector3i chunk_pos = anchor.chunk_pos + shells.offsets[i];
+				if (occupancy.test(chunk_pos))
+				{
+					continue;
+				}
+				if (is_uniform(chunk_pos))
+				{
+					occupancy.set(chunk_pos); // Classified here rather than when rebuilding, so only the shells walked cost columns
+					continue;
+				}
+
+				++anchor_candidate_count;
+				const float weight = anchor.view.get_chunk_weight(chunk_pos);
+				auto [it, is_inserted] = candidates.try_emplace(chunk_pos, weight);
+				if (!is_inserted)
+				{
+					it->second = std::min(it->second, weight); // Overlapping anchors keep the best weight
+				}
+			}
+
+			if (anchor_candidate_count == 0)
+			{
+				anchor.current_shell = shell + 1; // Every chunk in this shell is loaded
+			}
+			else if (max_shell_radius < 0.0f)
+			{
+				max_shell_radius = shell_radius * std::max(anchor.view.behind_camera_penalty, 1.0f);
+			}
+		}
+
+		// Prefetched chunks are outside the sphere, so they only win on weight against chunks behind the camera
+		if (anchor.prefetch)
+		{
+			const std::vector<Vector3i>& prefetch = *anchor.prefetch;
+			uint64_t prefetch_candidate_count = 0;
+			for (uint32_t i = anchor.prefetch_cursor; i < prefetch.size() && prefetch_candidate_count < max_candidates; ++i)
+			{
+				if (p_chunk_map.has_chunk(prefetch[i]) || is_uniform(prefetch[i]))
+				{
+					if (prefetch_candidate_count == 0)
+					{
+						anchor.prefetch_cursor = i + 1;
+					}
+					continue;
+				}
+
+				++prefetch_candidate_count;
+				const float weight = anchor.view.get_chunk_weight(prefetch[i]);
+				auto [it, is_inserted] = candidates.try_emplace(prefetch[i], weight);
+				if (!is_inserted)
+				{
+					it->second = std::min(it->second, weight);
+				}
+			}
+		}
+	}
+
+	std::vector<std::pair<float, Vector3i>> sorted_candidates{};
+	sorted_candidates.reserve(candidates.size());
+	for (const auto& [chunk_pos, weight] : candidates)
+	{
+		sorted_candidates.emplace_back(weight, chunk_pos);
+	}
+
+	const uint64_t count = std::min<uint64_t>(sorted_candidates.size(), p_max_count);
+	std::ranges::partial_sort(sorted_candidates, sorted_candidates.begin() + count, {}, &std::pair<float, Vector3i>::first);
+
+	std::vector<Vector3i> results{};
+	results.reserve(count);
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		results.push_back(sorted_candidates[i].second);
+	}
+
+	// The caller creates them straight away, marking them keeps them from being handed out twice
+	for (const Anchor& anchor : anchors_snapshot)
+	{
+		const chunk_shells::Shells& shells = chunk_shells::get_shells(anchor.shape);
+		for (const Vector3i& chunk_pos : results)
+		{
+			if (shells.contains(chunk_pos - anchor.chunk_pos, anchor.radius))
+			{
+				anchor.occupancy->set(chunk_pos);
+			}
+		}
+	}
+
+	{
+		// Anchors that changed since the snapshot keep their entering chunks and are redone next time
+		std::lock_guard lock(anchor_mutex);
+		for (Anchor& scanned : anchors_snapshot)
+		{
+			Anchor* anchor = find_anchor(scanned.id);
+			if (anchor && anchor->prefetch == scanned.prefetch)
+			{
+				anchor->prefetch_cursor = std::max(anchor->prefetch_cursor, scanned.prefetch_cursor);
+			}
+			if (anchor && anchor->revision == scanned.revision)
+			{
+				anchor->current_shell = std::max(anchor->current_shell, scanned.current_shell);
+				anchor->entering.clear();
+				anchor->missing_entering = std::move(scanned.missing_entering);
+				anchor->is_occupancy_valid = scanned.is_occupancy_valid;
+			}
+		}
+	}
+
+	return results;
+}
+
+std::vector<ChunkViewer::View> ChunkInterest::get_views() const
+{
+	std::lock_guard lock(anchor_mutex);
+	std::vector<ChunkViewer::View> views{};
+	views.reserve(anchors.size());
+	for (const Anchor& anchor : anchors)
+	{
+		views.push_back(anchor.view);
+	}
+	return views;
+}
+
+float ChunkInterest::get_chunk_weight(const std::vector<ChunkViewer::View>& p_views, const Vector3i& p_chunk_pos)
+{
+	if (p_views.empty())
+	{
+		return Vector3(p_chunk_pos).length();
+	}
+
+	float weight = p_views.front().get_chunk_weight(p_chunk_pos);
+	for (uint64_t i = 1; i < p_views.size(); ++i)
+	{
+		weight = std::min(weight, p_views[i].get_chunk_weight(p_chunk_pos));
+	}
+	return weight;
+}
+
+int32_t ChunkInterest::get_radius(const ChunkViewer& p_viewer)
+{
+	return static_cast<int32_t>(std::clamp<int64_t>(p_viewer.load_radius, MIN_RADIUS, chunk_shells::MAX_RADIUS));
+}
+
+chunk_shells::Shape ChunkInterest::get_shape(const ChunkViewer& p_viewer)
+{
+	return std::min(p_viewer.load_shape, chunk_shells::Shape::QuarterHeight);
+}
+
+int64_t ChunkInterest::get_anchor_count() const
+{
+	std::lock_guard lock(anchor_mutex);
+	return anchors.size();
+}
+
+ChunkInterest::Anchor* ChunkInterest::find_anchor(uint32_t p_anchor_id)
+{
+	for (Anchor& anchor : anchors)
+	{
+		if (anchor.id == p_anchor_id)
+		{
+			return &anchor;
+		}
+	}
+	return nullptr;
+}
+
+uint32_t ChunkInterest::attach(const Vector3i& p_chunk_pos, int32_t p_radius, chunk_shells::Shape p_shape)
+{
+	for (Anchor& anchor : anchors)
+	{
+		if (anchor.chunk_pos == p_chunk_pos && anchor.radius == p_radius && anchor.shape == p_shape)
+		{
+			++anchor.viewer_count;
+			return anchor.id;
+		}
+	}
+
+	Anchor anchor{};
+	anchor.id = next_anchor_id++;
+	anchor.chunk_pos = p_chunk_pos;
+	anchor.radius = p_radius;
+	anchor.shape = p_shape;
+	anchor.viewer_count = 1;
+	anchor.occupancy = std::make_shared<OccupancyGrid>();
+	{
+		std::lock_guard lock(anchor_mutex);
+		anchors.push_back(anchor);
+	}
+
+	jobs.push_back(Job{ p_chunk_pos, p_radius, p_shape, 1, 0 });
+	return anchor.id;
+}
+
+void ChunkInterest::detach(uint32_t p_anchor_id)
+{
+	Anchor* anchor = find_anchor(p_anchor_id);
+	if (!anchor || --anchor->viewer_count > 0)
+	{
+		return;
+	}
+
+	jobs.push_back(Job{ anchor->chunk_pos, anchor->radius, anchor->shape, -1, 0 });
+	if (anchor->prefetch)
+	{
+		for (const Vector3i& chunk_pos : *anchor->prefetch)
+		{
+			add_reference(chunk_pos, -1);
+		}
+	}
+
+	std::lock_guard lock(anchor_mutex);
+	std::erase_if(anchors, [p_anchor_id](const Anchor& other)
+			{ return other.id == p_anchor_id; });
+}
+
+void ChunkInterest::move_anchor(Anchor& p_anchor, const Vector3i& p_chunk_pos)
+{
+	const Vector3i from = p_anchor.chunk_pos;
+	const int32_t radius = p_anchor.radius;
+	const chunk_shells::Shape shape = p_anchor.shape;
+	const Vector3i delta = p_chunk_pos - from;
+	const int32_t step_count = std::max({ std::abs(delta.x), std::abs(delta.y), std::abs(delta.z) });
+
+	if (step_count > MAX_MOVE_STEPS)
+	{
+		// Teleported, swap the whole sphere over a few updates
+		jobs.push_back(Job{ from, radius, shape, -1, 0 });
+		jobs.push_back(Job{ p_chunk_pos, radius, shape, 1, 0 });
+
+		std::lock_guard lock(anchor_mutex);
+		p_anchor.chunk_pos = p_chunk_pos;
+		p_anchor.current_shell = 0;
+		p_anchor.entering.clear();
+		p_anchor.missing_entering.clear();
+		p_anchor.is_occupancy_valid = false;
+		++p_anchor.revision;
+		return;
+	}
+
+	// Walk one step at a time so every step is one of the precomputed slabs
+	std::vector<Vector3i> entering{};
+	uint32_t shells_back = 0;
+	Vector3i centre = from;
+	while (centre != p_chunk_pos)
+	{
+		const Vector3i remaining = p_chunk_pos - centre;
+		const Vector3i step(std::clamp(remaining.x, -1, 1), std::clamp(remaining.y, -1, 1), std::clamp(remaining.z, -1, 1));
+		const Vector3i next = centre + step;
+
+		for (const Vector3i& offset : delta_slabs::get_entering(shape, radius, step))
+		{
+			add_reference(next + offset, 1);
+			entering.push_back(next + offset);
+		}
+		for (const Vector3i& offset : delta_slabs::get_entering(shape, radius, -step))
+		{
+			add_reference(centre + offset, -1);
+		}
+
+		// Loaded shells stay loaded up to the step length closer in, a diagonal step is up to sqrt(3)
+		shells_back += chunk_shells::get_shells(shape).get_step_shells(step);
+		centre = next;
+	}
+
+	std::lock_guard lock(anchor_mutex);
+	p_anchor.chunk_pos = p_chunk_pos;
+	p_anchor.current_shell = p_anchor.current_shell > shells_back ? p_anchor.current_shell - shells_back : 0;
+	p_anchor.entering.insert(p_anchor.entering.end(), entering.begin(), entering.end());
+	if (p_anchor.entering.size() > MAX_ENTERING_CHUNKS)
+	{
+		p_anchor.entering.clear();
+		p_anchor.missing_entering.clear();
+		p_anchor.current_shell = 0;
+		p_anchor.is_occupancy_valid = false;
+	}
+	++p_anchor.revision;
+}
+
+void ChunkInterest::update_prefetch(Anchor& p_anchor)
+{
+	const ChunkViewer::View& view = p_anchor.view;
+	Vector3 velocity = view.velocity / CHUNK_SIZE;
+	const float horizon = view.prefetch_seconds;
+	const uint64_t limit = std::min<uint64_t>(static_cast<uint64_t>(std::max(chunks_per_second * horizon, 0.0f)), MAX_PREFETCH_CHUNKS);
+
+	// Step through the prediction a quarter of a chunk at a time, recording each chunk the centre passes through
+	std::vector<Vector3i> path{};
+	if (limit > 0 && velocity.length() >= MIN_PREFETCH_SPEED)
+	{
+		const Vector3 acceleration = view.acceleration / CHUNK_SIZE;
+		Vector3 position = view.position / CHUNK_SIZE;
+		Vector3i chunk_pos = p_anchor.chunk_pos;
+		float time = 0.0f;
+		while (time < horizon && path.size() < MAX_PREFETCH_STEPS)
+		{
+			const float delta = std::min(0.25f / std::max(velocity.length(), MIN_PREFETCH_SPEED), horizon - time);
+			if (time < MAX_ACCELERATION_SECONDS)
+			{
+				velocity += acceleration * delta;
+			}
+			position += velocity * delta;
+			time += delta;
+
+			const Vector3i next = Vector3i(position.floor());
+			while (chunk_pos != next && path.size() < MAX_PREFETCH_STEPS)
+			{
+				const Vector3i remaining = next - chunk_pos;
+				chunk_pos = chunk_pos + Vector3i(std::clamp(remaining.x, -1, 1), std::clamp(remaining.y, -1, 1), std::clamp(remaining.z, -1, 1));
+				path.push_back(chunk_pos);
+			}
+		}
+	}
+
+	if (path == p_anchor.prefetch_path && limit == p_anchor.prefetch_limit)
+	{
+		return;
+	}
+
+	// The slabs entering along the path, minus what the sphere already holds
+	const chunk_shells::Shells& shells = chunk_shells::get_shells(p_anchor.shape);
+	std::vector<Vector3i> prefetch{};
+	std::unordered_set<Vector3i, Vector3iHasher> prefetch_set{};
+	Vector3i centre = p_anchor.chunk_pos;
+	for (const Vector3i& next : path)
+	{
+		for (const Vector3i& offset : delta_slabs::get_entering(p_anchor.shape, p_anchor.radius, next - centre))
+		{
+			const Vector3i chunk_pos = next + offset;
+			if (prefetch.size() < limit && !shells.contains(chunk_pos - p_anchor.chunk_pos, p_anchor.radius) && prefetch_set.insert(chunk_pos).second)
+			{
+				prefetch.push_back(chunk_pos);
+			}
+		}
+		centre = next;
+	}
+
+	// Chunks that fell off the prediction are cancelled by dropping their reference
+	if (p_anchor.prefetch)
+	{
+		const std::unordered_set<Vector3i, Vector3iHasher> previous_set(p_anchor.prefetch->begin(), p_anchor.prefetch->end());
+		for (const Vector3i& chunk_pos : *p_anchor.prefetch)
+		{
+			if (!prefetch_set.contains(chunk_pos))
+			{
+				add_reference(chunk_pos, -1);
+			}
+		}
+		for (const Vector3i& chunk_pos : prefetch)
+		{
+			if (!previous_set.contains(chunk_pos))
+			{
+				add_reference(chunk_pos, 1);
+			}
+		}
+	}
+	else
+	{
+		for (const Vector3i& chunk_pos : prefetch)
+		{
+			add_reference(chunk_pos, 1);
+		}
+	}
+
+	std::lock_guard lock(anchor_mutex);
+	p_anchor.prefetch_path = std::move(path);
+	p_anchor.prefetch_limit = limit;
+	p_anchor.prefetch = prefetch.empty() ? nullptr : std::make_shared<const std::vector<Vector3i>>(std::move(prefetch));
+	p_anchor.prefetch_cursor = 0;
+}
+
+void ChunkInterest::add_reference(const Vector3i& p_chunk_pos, int32_t p_delta)
+{
+	int32_t& count = references[p_chunk_pos];
+	count += p_delta;
+	if (count <= 0)
+	{
+		release_candidates.insert(p_chunk_pos);
+	}
+}
+
+void ChunkInterest::process_jobs()
+{
+	uint64_t budget = JOB_OFFSETS_PER_UPDATE;
+	while (!jobs.empty() && budget > 0)
+	{
+		Job& job = jobs.front();
+		const chunk_shells::Shells& shells = chunk_shells::get_shells(job.shape);
+		const uint32_t end = shells.get_end(job.radius);
+		const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(end - job.next_index, budget));
+
+		for (uint32_t i = job.next_index; i < job.next_index + count; ++i)
+		{
+			add_reference(job.chunk_pos + shells.offsets[i], job.delta);
+		}
+
+		job.next_index += count;
+		budget -= count;
+		if (job.next_index >= end)
+		{
+			jobs.pop_front();
+		}
+	}
+}
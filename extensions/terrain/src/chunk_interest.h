@@ -0,0 +1,131 @@
+#pragma once
+
+#include "chunk_shells.h"
+#include "chunk_viewer.h"
+#include "concurrent_chunk_map.h"
+#include "height_range_oracle.h"
+#include "occupancy_grid.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace godot;
+
+/**
+ * @brief Merges any number of ChunkViewers into one load set
+ * Viewers in the same chunk with the same load radius and shape share an anchor, so overlapping viewers cost a single anchor.
+ * Every anchor holds a reference on each chunk in its sphere, a chunk is kept while anything references it.
+ * An anchor moving a few chunks only touches the slabs entering and leaving its sphere (see delta_slabs.h), adding or
+ * removing a whole sphere is spread over several updates.
+ * Each anchor tracks which chunks of its sphere were requested in an OccupancyGrid, so finding the missing ones doesn't
+ * go through the chunk map.
+ * A moving anchor also references the chunks entering its sphere along the path predicted from its viewer's velocity,
+ * up to as many as the pipeline generates in the viewer's prefetch_seconds. They're released when the prediction changes.
+ * Chunks a HeightRangeOracle calls all air or all rock are never requested, they're referenced like any other chunk though.
+ * update() is called from the main thread, get_chunk_positions() and get_views() from any thread.
+ */
+class ChunkInterest
+{
+public:
+	void add_viewer(ChunkViewer* p_viewer);
+	void remove_viewer(ChunkViewer* p_viewer);
+	void clear();
+	// Walks every anchor's shells from the centre again, call after chunks were unloaded without being released
+	void reset_cursors();
+
+	// Moves the anchors to their viewers, r_released gets the chunks nothing references anymore
+	void update(std::vector<Vector3i>& r_released);
+	// Measured chunks generated per second, sizes the prefetching
+	void set_throughput(float p_chunks_per_second) { chunks_per_second = p_chunks_per_second; }
+
+	// Missing chunks across every anchor, deduplicated and lowest weight first.
+	// Chunks p_oracle calls uniform are marked as requested instead of being returned
+	std::vector<Vector3i> get_chunk_positions(ConcurrentChunkMap& p_chunk_map, int64_t p_max_count, const HeightRangeOracle* p_oracle = nullptr);
+
+	// One view per anchor
+	std::vector<ChunkViewer::View> get_views() const;
+	// The lowest weight any of the views gives the chunk
+	static float get_chunk_weight(const std::vector<ChunkViewer::View>& p_views, const Vector3i& p_chunk_pos);
+
+	int64_t get_viewer_count() const { return viewers.size(); }
+	int64_t get_anchor_count() const;
+	int64_t get_referenced_count() const { return references.size(); }
+
+	// The viewer's load_radius clamped to what the shells cover
+	static int32_t get_radius(const ChunkViewer& p_viewer);
+	static chunk_shells::Shape get_shape(const ChunkViewer& p_viewer);
+
+private:
+	struct Viewer
+	{
+		uint64_t object_id = 0;
+		uint32_t anchor_id = 0;
+		bool has_anchor = false;
+	};
+
+	struct Anchor
+	{
+		uint32_t id = 0;
+		Vector3i chunk_pos{};
+		int32_t radius = 0;
+		chunk_shells::Shape shape = chunk_shells::Shape::Sphere;
+		int32_t viewer_count = 0;
+		ChunkViewer::View view{};
+		uint32_t current_shell = 0; // Shells before this are all loaded
+		std::vector<Vector3i> entering{}; // Chunks that entered the sphere, their slots still hold what wrapped out
+		std::vector<Vector3i> missing_entering{}; // Entering chunks that weren't loaded, requested before the shells
+		uint32_t revision = 0; // Bumped when it moves or its cursor is reset
+
+		std::shared_ptr<OccupancyGrid> occupancy{};
+		bool is_occupancy_valid = false; // Rebuilt from the chunk map when false
+
+		// Predicted chunk positions of the centre, each a single step from the one before
+		std::vector<Vector3i> prefetch_path{};
+		uint64_t prefetch_limit = 0;
+		// Chunks entering the sphere along the path, in path order. Replaced as a whole when the path changes
+		std::shared_ptr<const std::vector<Vector3i>> prefetch{};
+		uint32_t prefetch_cursor = 0; // Chunks before this are all loaded
+	};
+
+	// Adds or removes the references of a whole sphere, a few offsets per update
+	struct Job
+	{
+		Vector3i chunk_pos{};
+		int32_t radius = 0;
+		chunk_shells::Shape shape = chunk_shells::Shape::Sphere;
+		int32_t delta = 0;
+		uint32_t next_index = 0;
+	};
+
+	Anchor* find_anchor(uint32_t p_anchor_id);
+	uint32_t attach(const Vector3i& p_chunk_pos, int32_t p_radius, chunk_shells::Shape p_shape);
+	void detach(uint32_t p_anchor_id);
+	void move_anchor(Anchor& p_anchor, const Vector3i& p_chunk_pos);
+	void update_prefetch(Anchor& p_anchor);
+	void add_reference(const Vector3i& p_chunk_pos, int32_t p_delta);
+	void process_jobs();
+
+	std::vector<Viewer> viewers{};
+
+	// Shared with get_chunk_positions
+	std::vector<Anchor> anchors{};
+	mutable std::mutex anchor_mutex{};
+	uint32_t next_anchor_id = 0;
+
+	// Serialises get_chunk_positions so concurrent callers don't hand out the same chunks
+	std::mutex cursor_mutex{};
+
+	std::deque<Job> jobs{};
+	// Can briefly go negative while jobs are pending, chunks are only released once every job is done
+	std::unordered_map<Vector3i, int32_t, Vector3iHasher> references{};
+	std::unordered_set<Vector3i, Vector3iHasher> release_candidates{};
+
+	float chunks_per_second = 0.0f;
+};
@@ -1,19 +1,32 @@
 #include "chunk_loader.h"
 
+#include "cave_culling.h"
 #include "chunk_data.h"
 #include "chunk_generator.h"
+#include "chunk_interest.h"
+#include "chunk_shells.h"
+#include "chunk_viewer.h"
 #include "collision_generator.h"
 #include "concurrent_chunk_map.h"
+#include "delta_slabs.h"
+#include "epoch_manager.h"
 #include "godot_utility.h"
 #include "mesh_generator.h"
+#include "server_chunk_store.h"
 #include "terrain_constants.h"
+#include "terrain_math.h"
 #include "terrain_performance_monitor.h"
+#include "terrain_raycast.h"
 #include "thread_pool.h"
 
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/concave_polygon_shape3d.hpp>
 #include <godot_cpp/classes/global_constants.hpp>
 #include <godot_cpp/classes/ref.hpp>
 #include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/viewport.hpp>
 #include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/classes/world3d.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/core/defs.hpp>
 #include <godot_cpp/core/math.hpp>
@@ -22,6 +35,9 @@
 #include <godot_cpp/core/property_info.hpp>
 #include <godot_cpp/variant/callable.hpp>
 #include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
 #include <godot_cpp/variant/variant.hpp>
 #include <godot_cpp/variant/vector3.hpp>
 #include <godot_cpp/variant/vector3i.hpp>
@@ -30,12 +46,34 @@
 #include <chunk.h>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 using namespace godot;
 using namespace terrain_constants;
+using namespace terrain_math;
+
+// Rays per WorkerThreadPool task in the batched queries
+constexpr int64_t CASTS_PER_TASK = 64;
+// Only the closest meshes are sorted, more than this are rarely applied in a frame
+constexpr uint64_t MESH_SORT_COUNT = 32;
+// Newly generated chunks only re-run the cave culling search this often, moving chunks re-runs it straight away
+constexpr uint64_t CAVE_CULLING_INTERVAL_USEC = 250'000;
+// Throughput and time to visible are averaged over windows this long
+constexpr uint64_t PIPELINE_STATS_INTERVAL_USEC = 500'000;
+// Leading edge chunks not drawn by then are air, solid or culled and are no longer waited on
+constexpr uint64_t LEADING_EDGE_TIMEOUT_USEC = 10'000'000;
+// Longer moves are teleports, there's no edge to lead
+constexpr int32_t MAX_LEADING_EDGE_STEPS = 4;
+// Unused chunk memory past this many per pool shard goes back to the system as unloaded chunks are reclaimed, so
+// walking back and forth over a boundary doesn't commit and decommit the same blocks
+constexpr uint64_t POOL_KEEP_FREE_PER_SHARD = 128;
 
 void ChunkLoader::_bind_methods()
 {
@@ -51,6 +89,17 @@ void ChunkLoader::_bind_methods()
 
 	ClassDB::bind_method(D_METHOD("modify_terrain", "global_position", "is_subtract"), &ChunkLoader::modify_terrain);
 
+	ClassDB::bind_method(D_METHOD("add_viewer", "viewer"), &ChunkLoader::add_viewer);
+	ClassDB::bind_method(D_METHOD("remove_viewer", "viewer"), &ChunkLoader::remove_viewer);
+
+	ClassDB::bind_method(D_METHOD("add_collision_body", "body", "radius"), &ChunkLoader::add_collision_body, DEFVAL(CHUNK_SIZE));
+	ClassDB::bind_method(D_METHOD("remove_collision_body", "body"), &ChunkLoader::remove_collision_body);
+
+	ClassDB::bind_method(D_METHOD("raycast", "from", "to"), &ChunkLoader::raycast);
+	ClassDB::bind_method(D_METHOD("sphere_cast", "from", "to", "radius"), &ChunkLoader::sphere_cast);
+	ClassDB::bind_method(D_METHOD("raycast_batch", "from", "to"), &ChunkLoader::raycast_batch);
+	ClassDB::bind_method(D_METHOD("sphere_cast_batch", "from", "to", "radius"), &ChunkLoader::sphere_cast_batch);
+
 	ClassDB::bind_method(D_METHOD("get_chunk_viewer"), &ChunkLoader::get_chunk_viewer);
 	ClassDB::bind_method(D_METHOD("set_chunk_viewer", "chunk_viewer"), &ChunkLoader::set_chunk_viewer);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "chunk_viewer", PROPERTY_HINT_NODE_TYPE, "ChunkViewer"), "set_chunk_viewer", "get_chunk_viewer");
@@ -62,6 +111,44 @@ void ChunkLoader::_bind_methods()
 	ClassDB::bind_method(D_METHOD("get_material"), &ChunkLoader::get_material);
 	ClassDB::bind_method(D_METHOD("set_material", "material"), &ChunkLoader::set_material);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "material", PROPERTY_HINT_RESOURCE_TYPE, "StandardMaterial3D"), "set_material", "get_material");
+
+	ClassDB::bind_method(D_METHOD("get_use_server_rids"), &ChunkLoader::get_use_server_rids);
+	ClassDB::bind_method(D_METHOD("set_use_server_rids", "use_server_rids"), &ChunkLoader::set_use_server_rids);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_server_rids"), "set_use_server_rids", "get_use_server_rids");
+
+	ADD_GROUP("Region", "region_");
+	ClassDB::bind_method(D_METHOD("get_region_merging"), &ChunkLoader::get_region_merging);
+	ClassDB::bind_method(D_METHOD("set_region_merging", "region_merging"), &ChunkLoader::set_region_merging);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "region_merging"), "set_region_merging", "get_region_merging");
+
+	ClassDB::bind_method(D_METHOD("get_region_near_distance"), &ChunkLoader::get_region_near_distance);
+	ClassDB::bind_method(D_METHOD("set_region_near_distance", "region_near_distance"), &ChunkLoader::set_region_near_distance);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "region_near_distance", PROPERTY_HINT_RANGE, "0,64,0.5,or_greater,suffix:chunks"), "set_region_near_distance", "get_region_near_distance");
+
+	ClassDB::bind_method(D_METHOD("get_region_far_distance"), &ChunkLoader::get_region_far_distance);
+	ClassDB::bind_method(D_METHOD("set_region_far_distance", "region_far_distance"), &ChunkLoader::set_region_far_distance);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "region_far_distance", PROPERTY_HINT_RANGE, "0,64,0.5,or_greater,suffix:chunks"), "set_region_far_distance", "get_region_far_distance");
+
+	ClassDB::bind_method(D_METHOD("get_cull_caves"), &ChunkLoader::get_cull_caves);
+	ClassDB::bind_method(D_METHOD("set_cull_caves", "cull_caves"), &ChunkLoader::set_cull_caves);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "cull_caves"), "set_cull_caves", "get_cull_caves");
+
+	ClassDB::bind_method(D_METHOD("get_cull_height_range"), &ChunkLoader::get_cull_height_range);
+	ClassDB::bind_method(D_METHOD("set_cull_height_range", "cull_height_range"), &ChunkLoader::set_cull_height_range);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "cull_height_range"), "set_cull_height_range", "get_cull_height_range");
+
+	ADD_GROUP("Collision", "collision_");
+	ClassDB::bind_method(D_METHOD("get_collision_triangle_budget"), &ChunkLoader::get_collision_triangle_budget);
+	ClassDB::bind_method(D_METHOD("set_collision_triangle_budget", "collision_triangle_budget"), &ChunkLoader::set_collision_triangle_budget);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "collision_triangle_budget", PROPERTY_HINT_RANGE, "0,65536,1,or_greater"), "set_collision_triangle_budget", "get_collision_triangle_budget");
+
+	ClassDB::bind_method(D_METHOD("get_collision_max_error"), &ChunkLoader::get_collision_max_error);
+	ClassDB::bind_method(D_METHOD("set_collision_max_error", "collision_max_error"), &ChunkLoader::set_collision_max_error);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "collision_max_error", PROPERTY_HINT_RANGE, "0,4,0.01,or_greater"), "set_collision_max_error", "get_collision_max_error");
+
+	ClassDB::bind_method(D_METHOD("get_collision_updates_per_tick"), &ChunkLoader::get_collision_updates_per_tick);
+	ClassDB::bind_method(D_METHOD("set_collision_updates_per_tick", "collision_updates_per_tick"), &ChunkLoader::set_collision_updates_per_tick);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "collision_updates_per_tick", PROPERTY_HINT_RANGE, "1,256,1,or_greater"), "set_collision_updates_per_tick", "get_collision_updates_per_tick");
 }
 
 bool ChunkLoader::init()
@@ -84,12 +171,76 @@ bool ChunkLoader::init()
 		return false;
 	}
 
-	if (!chunk_viewer)
+	ChunkViewer* chunk_viewer = get_chunk_viewer();
+	if (!chunk_viewer && chunk_interest.get_viewer_count() == 0)
 	{
-		PRINT_ERROR("chunk_viewer not set!");
+		PRINT_ERROR("chunk_viewer not set and no viewers added!");
 		return false;
 	}
 
+	if (use_server_rids || region_merging)
+	{
+		Viewport* viewport = is_inside_tree() ? get_viewport() : nullptr;
+		Ref<World3D> world = viewport ? viewport->find_world_3d() : Ref<World3D>();
+		if (!world.is_valid())
+		{
+			PRINT_ERROR("use_server_rids and region_merging need the Chunk Loader to be inside a 3D world!");
+			return false;
+		}
+
+		if (use_server_rids)
+		{
+			server_chunk_store.init(world->get_scenario(), world->get_space(), material->get_rid());
+		}
+
+		if (region_merging)
+		{
+			region_meshes.init(world->get_scenario(), material->get_rid(), region_near_distance, region_far_distance, [this](const Vector3i& p_chunk_pos, bool p_visible)
+					{ set_chunk_visible(p_chunk_pos, p_visible && !culled_chunks.contains(p_chunk_pos)); });
+		}
+	}
+	server_rids_active = use_server_rids;
+	region_merging_active = region_merging;
+	cave_culling_active = cull_caves && chunk_viewer != nullptr; // Culls from the main viewer's point of view
+	cave_culling_dirty = true;
+	last_cave_culling_usec = 0;
+	// Made again each time, the settings can change while stopped
+	height_range_oracle = cull_height_range ? std::make_shared<HeightRangeOracle>(chunk_generator_settings) : nullptr;
+
+	if (region_merging_active)
+	{
+		if (!region_mesh_generator_pool.is_valid())
+		{
+			region_mesh_generator_pool.reference_ptr(memnew((RegionMeshGeneratorPool)));
+		}
+
+		if (region_mesh_generator_pool->get_state() == ThreadPoolState::Stopped)
+		{
+			constexpr int64_t region_mesh_generator_thread_count = 1;
+			region_mesh_generator_pool->init(region_mesh_generator_thread_count, "", []()
+					{ return RegionMeshGenerator::create(); });
+		}
+		else
+		{
+			PRINT_ERROR("region_mesh_generator_pool is stopping! It can't be initialised.");
+			return false;
+		}
+	}
+
+	if (!chunk_map)
+	{
+		chunk_map = std::make_shared<ConcurrentChunkMap>(); // Its pools commit memory as chunks are loaded
+	}
+
+	if (!array_mesh_pool)
+	{
+		array_mesh_pool = std::make_shared<ResourcePool<ArrayMesh>>();
+	}
+	if (!collision_shape_pool)
+	{
+		collision_shape_pool = std::make_shared<ResourcePool<ConcavePolygonShape3D>>();
+	}
+
 	if (!mesh_generator_pool.is_valid())
 	{
 		mesh_generator_pool.reference_ptr(memnew((MeshGeneratorPool)));
@@ -98,8 +249,8 @@ bool ChunkLoader::init()
 	if (mesh_generator_pool->get_state() == ThreadPoolState::Stopped)
 	{
 		constexpr int64_t mesh_generator_thread_count = 1;
-		mesh_generator_pool->init(mesh_generator_thread_count, "", []()
-				{ return MeshGenerator::create(); });
+		mesh_generator_pool->init(mesh_generator_thread_count, "", [map = std::shared_ptr<const ConcurrentChunkMap>(chunk_map), pool = array_mesh_pool, keep_mesh_arrays = region_merging_active]()
+				{ return MeshGenerator::create(map, pool, keep_mesh_arrays); });
 	}
 	else
 	{
@@ -115,8 +266,8 @@ bool ChunkLoader::init()
 	if (chunk_generator_pool->get_state() == ThreadPoolState::Stopped)
 	{
 		constexpr int64_t chunk_generator_thread_count = 8;
-		chunk_generator_pool->init(chunk_generator_thread_count, "", [settings = chunk_generator_settings]()
-				{ return ChunkGenerator::create(settings); });
+		chunk_generator_pool->init(chunk_generator_thread_count, "", [settings = chunk_generator_settings, map = std::shared_ptr<const ConcurrentChunkMap>(chunk_map)]()
+				{ return ChunkGenerator::create(settings, map); });
 	}
 	else
 	{
@@ -132,8 +283,8 @@ bool ChunkLoader::init()
 	if (collision_generator_pool->get_state() == ThreadPoolState::Stopped)
 	{
 		constexpr int64_t collision_generator_thread_count = 1;
-		collision_generator_pool->init(collision_generator_thread_count, "", []()
-				{ return CollisionGenerator::create(); });
+		collision_generator_pool->init(collision_generator_thread_count, "", [budget = collision_triangle_budget, max_error = collision_max_error, pool = collision_shape_pool, map = std::shared_ptr<const ConcurrentChunkMap>(chunk_map)]()
+				{ return CollisionGenerator::create(budget, max_error, pool, map); });
 	}
 	else
 	{
@@ -141,25 +292,40 @@ bool ChunkLoader::init()
 		return false;
 	}
 
-	if (!chunk_map)
-	{
-		chunk_map = std::make_shared<ConcurrentChunkMap>();
-		chunk_viewer->chunk_map = chunk_map;
-		chunk_map->pre_allocate_chunks_per_shard(1024); // This should be pre-allocated based on render distance
-	}
-
 	TerrainPerformanceMonitor* performance_monitor = TerrainPerformanceMonitor::get_singleton();
 	if (performance_monitor)
 	{
 		performance_monitor->set_chunk_loader(this);
 	}
 
-	chunk_viewer->reset();
+	chunk_interest.reset_cursors();
+	frame_budget.reset();
+
+	if (chunk_viewer)
+	{
+		// Keep collision around the viewer by default
+		chunk_interest.add_viewer(chunk_viewer);
+		collision_interest.add_body(chunk_viewer, CHUNK_SIZE);
+	}
+	set_physics_process(true);
 
 	state = State::Ready;
 	return true;
 }
 
+void ChunkLoader::_exit_tree()
+{
+	// Workers must be done with the map before it's emptied, and nothing they made may be applied to the world being left
+	if (state == State::Ready)
+	{
+		stop();
+	}
+	// Everything drawn is dropped with the map, so re-entering loads and draws it all again
+	unload_all();
+	// The scenario and space belong to the world being left
+	server_chunk_store.clear();
+}
+
 void ChunkLoader::update()
 {
 	if (state != State::Ready)
@@ -168,69 +334,116 @@ void ChunkLoader::update()
 		return;
 	}
 
+	frame_budget.begin_frame();
+
+	update_pipeline_stats();
+	update_chunk_interest();
+	if (chunk_map->reclaim() > 0)
+	{
+		chunk_map->trim_pools(POOL_KEEP_FREE_PER_SHARD);
+	}
+	update_leading_edge();
+	remesh_dirty_chunks();
 	try_update_chunks();
 
-	uint64_t start_time = Time::get_singleton()->get_ticks_usec();
-	// budget in microseconds: 2000us = 2ms
-	constexpr uint64_t time_budget = 4000;
+	ChunkViewer* chunk_viewer = get_chunk_viewer();
 
 	{ // move the done meshes to our array so we can take time applying them
 		std::vector<MeshData> done_mesh_datas = mesh_generator_pool->take_results();
 
-		// TODO: only queue close chunks, use something the Chunk Viewer to manage this
-		Vector3 centre_pos = chunk_viewer->get_current_chunk_pos();
-		float collision_radius_sqr = 2 * 2;
-		for (const MeshData& mesh_data : done_mesh_datas)
-		{
-			if (centre_pos.distance_squared_to(mesh_data.chunk_pos) < collision_radius_sqr)
-			{
-				collision_generator_pool->queue_task(done_mesh_datas);
-			}
-		}
-
-		if (!done_mesh_datas.empty())
+		const Vector3i centre_chunk_pos = chunk_viewer ? chunk_viewer->get_current_chunk_pos() : Vector3i();
+		if (!done_mesh_datas.empty() || centre_chunk_pos != last_sort_chunk_pos)
 		{
 			mesh_datas.insert(
 					mesh_datas.end(),
 					std::make_move_iterator(done_mesh_datas.begin()),
 					std::make_move_iterator(done_mesh_datas.end()));
 
-			Vector3 centre_pos = chunk_viewer->get_current_chunk_pos();
-			uint64_t count = std::min<uint64_t>(mesh_datas.size(), 10); // It's unlikely we'll process more than 10, so only sort that many
-			// Sort x closest positions to the back, using reverse iterators
+			uint64_t start_time = Time::get_singleton()->get_ticks_usec();
+
+			// Applying follows the main viewer, without one it goes by every viewer
+			const std::vector<ChunkViewer::View> views = chunk_viewer ? std::vector<ChunkViewer::View>{ chunk_viewer->get_view() } : chunk_interest.get_views();
+			uint64_t count = std::min<uint64_t>(mesh_datas.size(), MESH_SORT_COUNT); // It's unlikely we'll process more than this, so only sort that many
+			// Sort x best weighted positions to the back, using reverse iterators
 			std::ranges::partial_sort(
 					mesh_datas.rbegin(),
 					mesh_datas.rbegin() + count,
 					mesh_datas.rend(),
-					[centre_pos](const auto& a, const auto& b)
-					{ return centre_pos.distance_squared_to(a.chunk_pos) < centre_pos.distance_squared_to(b.chunk_pos); });
+					{},
+					[&views](const MeshData& mesh_data)
+					{ return ChunkInterest::get_chunk_weight(views, mesh_data.chunk_pos); });
+			last_sort_chunk_pos = centre_chunk_pos;
 
-			if (Time::get_singleton()->get_ticks_usec() - start_time > time_budget)
+			if (Time::get_singleton()->get_ticks_usec() - start_time > frame_budget.get_budget_usec())
 			{
 				PRINT_ERROR("sorting %d mesh data took too long!", static_cast<uint64_t>(mesh_datas.size()));
 			}
 		}
 	}
 
-	while (!mesh_datas.empty())
+	// Near meshes get the budget first, then the rest get what is left. Collision is applied in _physics_process
+	apply_meshes(FrameBudget::Priority::Near);
+	update_collision_interest();
+	take_collision_results();
+	apply_meshes(FrameBudget::Priority::Far);
+	update_regions();
+	update_cave_culling();
+}
+
+void ChunkLoader::apply_meshes(FrameBudget::Priority p_priority)
+{
+	ChunkViewer* chunk_viewer = get_chunk_viewer();
+	if (p_priority == FrameBudget::Priority::Near && !chunk_viewer)
 	{
-		if (Time::get_singleton()->get_ticks_usec() - start_time > time_budget)
+		return; // Nothing is near without a main viewer
+	}
+
+	const Vector3i centre_chunk_pos = chunk_viewer ? chunk_viewer->get_current_chunk_pos() : Vector3i();
+	// Meshes within the viewer's near radius are applied first, the same chunks it always loads first
+	const float near_radius = chunk_viewer ? chunk_viewer->get_view().near_radius : 0.0f;
+	const float near_distance_squared = near_radius * near_radius;
+	while (!mesh_datas.empty() && frame_budget.can_apply(p_priority))
+	{
+		if (p_priority == FrameBudget::Priority::Near && (mesh_datas.back().chunk_pos - centre_chunk_pos).length_squared() > near_distance_squared)
 		{
 			break;
 		}
 
-		MeshData mesh_data = mesh_datas.back();
+		const uint64_t start_time = Time::get_singleton()->get_ticks_usec();
+
+		MeshData mesh_data = std::move(mesh_datas.back());
 		mesh_datas.pop_back();
 
-		Chunk* chunk = get_chunk(mesh_data.chunk_pos);
-		chunk->update_chunk_mesh(mesh_data);
-	}
+		if (!chunk_map->is_current(mesh_data.chunk_pos, mesh_data.chunk_version))
+		{
+			// Unloaded or edited after the worker's check, the mesh of the newer version is on its way
+			array_mesh_pool->release(mesh_data.array_mesh);
+			continue;
+		}
 
-	std::vector<CollisionData> collision_datas = collision_generator_pool->take_results();
-	for (CollisionData& collision_data : collision_datas)
-	{
-		Chunk* chunk = get_chunk(collision_data.chunk_pos);
-		chunk->update_chunk_collision(collision_data);
+		apply_chunk_mesh(mesh_data);
+		if (mesh_data.array_mesh.is_valid())
+		{
+			mesh_became_visible(mesh_data.chunk_pos);
+		}
+		if (cave_culling_reachable && !cave_culling_reachable->contains(mesh_data.chunk_pos))
+		{
+			// Went out of reach while it was being meshed
+			culled_chunks.insert(mesh_data.chunk_pos);
+			set_chunk_visible(mesh_data.chunk_pos, false);
+		}
+		if (region_merging_active)
+		{
+			region_meshes.chunk_mesh_changed(mesh_data);
+		}
+
+		// The mesh changed, so the collision has to be rebuilt
+		if (collision_interest.is_wanted(mesh_data.chunk_pos))
+		{
+			queue_collision(mesh_data);
+		}
+
+		frame_budget.applied(p_priority, start_time);
 	}
 }
 
@@ -244,10 +457,32 @@ void ChunkLoader::stop()
 
 	state = State::Stopping;
 
+	// It queues to the pools, let it finish before they're stopped
+	while (update_chunks_running)
+	{
+		std::this_thread::yield();
+	}
+
 	mesh_generator_pool->stop(); // Blocks execution until all threads are stopped
+	for (MeshData& mesh_data : mesh_datas)
+	{
+		array_mesh_pool->release(mesh_data.array_mesh);
+	}
+	mesh_datas.clear();
 
 	chunk_generator_pool->stop();
 
+	collision_generator_pool->stop();
+	collision_pending.clear();
+	collision_stale.clear();
+	collision_updates.clear();
+	set_physics_process(false);
+
+	if (region_mesh_generator_pool.is_valid() && region_mesh_generator_pool->get_state() == ThreadPoolState::Ready)
+	{
+		region_mesh_generator_pool->stop();
+	}
+
 	state = State::Stopped;
 }
 
@@ -270,130 +505,776 @@ void ChunkLoader::try_update_chunks()
 		return;
 	}
 
+	// One at a time, a second one would pick the same positions before the first had created them
+	if (update_chunks_running)
+	{
+		return;
+	}
+	update_chunks_running = true;
+
 	Callable update_func = callable_mp(this, &ChunkLoader::_update_chunks);
 	WorkerThreadPool::get_singleton()->add_task(update_func);
 }
 
 void ChunkLoader::_update_chunks()
 {
-	if (!chunk_viewer)
+	constexpr int64_t CHUNK_GEN_BATCH_SIZE = 128;
+	// Runs alongside the main thread unloading, the chunks it looks at are pinned until it's done. What it queues isn't
+	const EpochManager::Pin pin = chunk_map->pin();
+
+	std::vector<Vector3i> chunk_positions = chunk_interest.get_chunk_positions(*chunk_map, CHUNK_GEN_BATCH_SIZE, height_range_oracle.get());
+	if (chunk_positions.size() > 0)
+	{
+		std::vector<ChunkData*> chunks;
+		std::vector<uint8_t> created;
+		chunk_map->get_or_create_many(chunk_positions, chunks, created);
+		// Chunks that were already loaded are generated or queued, generating them again would write to a published chunk
+		std::vector<ChunkTask> chunks_to_generate;
+		chunks_to_generate.reserve(chunks.size());
+		for (uint64_t i = 0; i < chunks.size(); ++i)
+		{
+			if (created[i])
+			{
+				chunks_to_generate.push_back({ chunks[i]->position, chunks[i]->version });
+			}
+		}
+		chunk_generator_pool->queue_task(std::move(chunks_to_generate));
+	}
+
+	// TODO: Add a better way to queue these tasks. Pipe the chunk_generator_pool to the mesh_generator_pool
+	std::vector<ChunkTask> chunk_datas = chunk_generator_pool->take_results();
+	generated_chunk_count.fetch_add(chunk_datas.size(), std::memory_order_relaxed);
+	// Remove empty and full chunks as they don't need to be generated, and ones unloaded while they were generated
+	std::erase_if(chunk_datas, [this](const ChunkTask& chunk_task)
+			{
+				const ChunkData* chunk_data = chunk_map->get_current(chunk_task.position, chunk_task.version);
+				return !chunk_data || chunk_data->surface_state != SurfaceState::MIXED;
+			});
+
+	if (cave_culling_active && !chunk_datas.empty())
+	{
+		// Chunks out of reach are parked until a search reaches them, see apply_cave_culling
+		if (std::shared_ptr<const CaveCulling::ChunkSet> reachable = cave_culling.get_reachable())
+		{
+			std::lock_guard lock(parked_chunks_mutex);
+			std::erase_if(chunk_datas, [&](const ChunkTask& chunk_task)
+					{
+						if (reachable->contains(chunk_task.position))
+						{
+							return false;
+						}
+						parked_chunks.insert(chunk_task.position);
+						return true;
+					});
+		}
+		// Their connectivity can open up new paths
+		cave_culling_dirty = true;
+	}
+
+	// Mesh what's in view first, the weights are worked out once as every viewer is checked
+	const std::vector<ChunkViewer::View> views = chunk_interest.get_views();
+	std::vector<std::pair<float, ChunkTask>> weighted_chunk_datas;
+	weighted_chunk_datas.reserve(chunk_datas.size());
+	for (const ChunkTask& chunk_task : chunk_datas)
+	{
+		const float weight = ChunkInterest::get_chunk_weight(views, chunk_task.position);
+		weighted_chunk_datas.emplace_back(weight, chunk_task);
+	}
+	std::ranges::sort(weighted_chunk_datas, {}, &std::pair<float, ChunkTask>::first);
+	for (uint64_t i = 0; i < weighted_chunk_datas.size(); ++i)
+	{
+		chunk_datas[i] = weighted_chunk_datas[i].second;
+	}
+
+	mesh_generator_pool->queue_task(std::move(chunk_datas));
+	update_chunks_running = false;
+}
+
+void ChunkLoader::update_collision_interest()
+{
+	std::vector<Vector3i> entered;
+	std::vector<Vector3i> exited;
+	collision_interest.update(entered, exited);
+
+	for (const Vector3i& chunk_pos : entered)
+	{
+		const MeshData mesh_data = get_drawn_mesh_data(chunk_pos);
+		if (mesh_data.array_mesh.is_valid())
+		{
+			queue_collision(mesh_data);
+		}
+		// Otherwise collision gets queued when the mesh is applied
+	}
+
+	for (const Vector3i& chunk_pos : exited)
+	{
+		collision_updates.erase(chunk_pos);
+		if (chunk_has_collision(chunk_pos))
+		{
+			CollisionData empty_collision{};
+			empty_collision.chunk_pos = chunk_pos;
+			collision_updates[chunk_pos] = empty_collision;
+		}
+	}
+}
+
+void ChunkLoader::queue_collision(const MeshData& p_mesh_data)
+{
+	const Vector3i chunk_pos = p_mesh_data.chunk_pos;
+	if (collision_pending.contains(chunk_pos))
+	{
+		// Still queued, the newer mesh takes its place
+		const int64_t cancelled_count = collision_generator_pool->cancel_tasks([&chunk_pos](const MeshData& p_queued)
+				{ return p_queued.chunk_pos == chunk_pos; });
+		if (cancelled_count == 0)
+		{
+			// Re-queued with the latest mesh once the in flight task is done
+			collision_stale.insert(chunk_pos);
+			return;
+		}
+	}
+
+	collision_pending.insert(chunk_pos);
+	collision_generator_pool->queue_task(p_mesh_data);
+}
+
+void ChunkLoader::take_collision_results()
+{
+	std::vector<CollisionData> collision_datas = collision_generator_pool->take_results();
+	for (CollisionData& collision_data : collision_datas)
+	{
+		const Vector3i chunk_pos = collision_data.chunk_pos;
+		collision_pending.erase(chunk_pos);
+
+		if (!collision_interest.is_wanted(chunk_pos))
+		{
+			collision_stale.erase(chunk_pos);
+			collision_shape_pool->release(collision_data.collision_shape);
+			continue; // No body needs it anymore
+		}
+
+		if (collision_stale.erase(chunk_pos) > 0)
+		{
+			// Built from an outdated mesh
+			collision_shape_pool->release(collision_data.collision_shape);
+			queue_collision(get_drawn_mesh_data(chunk_pos));
+			continue;
+		}
+
+		if (!chunk_map->is_current(chunk_pos, collision_data.chunk_version))
+		{
+			// The chunk changed since its mesh was built, the newer mesh queues its own collision once it's applied
+			collision_shape_pool->release(collision_data.collision_shape);
+			continue;
+		}
+
+		// Replaces any update still waiting for a physics tick
+		collision_updates[chunk_pos] = std::move(collision_data);
+	}
+}
+
+void ChunkLoader::_physics_process(double p_delta)
+{
+	if (state != State::Ready)
 	{
-		PRINT_ERROR("chunk_viewer not set!");
 		return;
 	}
 
-	constexpr int64_t CHUNK_GEN_BATCH_SIZE = 128;
-	std::vector<Vector3i> chunk_positions = chunk_viewer->get_chunk_positions(CHUNK_GEN_BATCH_SIZE);
-	if (chunk_positions.size() > 0)
+	// Capped so a burst of edits is spread over several ticks instead of one physics spike
+	int64_t applied_count = 0;
+	for (auto it = collision_updates.begin(); it != collision_updates.end() && applied_count < collision_updates_per_tick;)
 	{
-		std::vector<ChunkData*> chunks_to_generate;
-		chunks_to_generate.reserve(chunk_positions.size());
-		for (Vector3i chunk_pos : chunk_positions)
+		apply_chunk_collision(it->second);
+		it = collision_updates.erase(it);
+		++applied_count;
+	}
+}
+
+void ChunkLoader::update_regions()
+{
+	if (!region_merging_active)
+	{
+		return;
+	}
+
+	std::vector<RegionMeshData> region_mesh_datas = region_mesh_generator_pool->take_results();
+	for (const RegionMeshData& region_mesh_data : region_mesh_datas)
+	{
+		region_meshes.apply_result(region_mesh_data);
+	}
+
+	if (ChunkViewer* chunk_viewer = get_chunk_viewer())
+	{
+		region_meshes.set_viewer_chunk_pos(chunk_viewer->get_current_chunk_pos());
+	}
+
+	std::vector<RegionMeshTask> region_mesh_tasks;
+	while (region_meshes.has_pending_updates() && frame_budget.can_apply(FrameBudget::Priority::Regions))
+	{
+		const uint64_t start_time = Time::get_singleton()->get_ticks_usec();
+		region_meshes.update_next(region_mesh_tasks);
+		frame_budget.applied(FrameBudget::Priority::Regions, start_time);
+	}
+
+	if (!region_mesh_tasks.empty())
+	{
+		region_mesh_generator_pool->queue_task(region_mesh_tasks);
+	}
+}
+
+void ChunkLoader::update_cave_culling()
+{
+	if (!cave_culling_active)
+	{
+		return;
+	}
+
+	const uint64_t result_id = cave_culling.get_result_id();
+	if (result_id != applied_cave_culling_id)
+	{
+		applied_cave_culling_id = result_id;
+		apply_cave_culling();
+	}
+
+	ChunkViewer* chunk_viewer = get_chunk_viewer();
+	if (cave_culling_running || !chunk_viewer)
+	{
+		return;
+	}
+
+	const Vector3i viewer_chunk_pos = chunk_viewer->get_current_chunk_pos();
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	const bool has_moved = viewer_chunk_pos != cave_culling_origin;
+	if (!has_moved && !(cave_culling_dirty && now - last_cave_culling_usec >= CAVE_CULLING_INTERVAL_USEC))
+	{
+		return;
+	}
+
+	cave_culling_dirty = false;
+	cave_culling_origin = viewer_chunk_pos;
+	last_cave_culling_usec = now;
+	cave_culling_running = true;
+
+	Callable cave_culling_func = callable_mp(this, &ChunkLoader::_update_cave_culling);
+	WorkerThreadPool::get_singleton()->add_task(cave_culling_func);
+}
+
+void ChunkLoader::_update_cave_culling()
+{
+	cave_culling.update(*chunk_map, cave_culling_origin, chunk_shells::MAX_RADIUS, height_range_oracle.get());
+	cave_culling_running = false;
+}
+
+void ChunkLoader::apply_cave_culling()
+{
+	cave_culling_reachable = cave_culling.get_reachable();
+
+	std::vector<Vector3i> chunk_positions;
+	get_drawn_chunk_positions(chunk_positions);
+
+	if (!cave_culling_reachable)
+	{
+		// Cleared, show everything again
+		for (const Vector3i& chunk_pos : culled_chunks)
 		{
-			chunks_to_generate.push_back(chunk_map->get_or_create(chunk_pos));
+			set_chunk_visible(chunk_pos, !(region_merging_active && region_meshes.is_chunk_hidden(chunk_pos)));
 		}
+		culled_chunks.clear();
+		return;
+	}
 
-		chunk_generator_pool->queue_task(chunks_to_generate);
+	const CaveCulling::ChunkSet& reachable = *cave_culling_reachable;
+
+	const EpochManager::Pin pin = chunk_map->pin();
+	std::vector<ChunkTask> chunks_to_mesh;
+	{
+		std::lock_guard lock(parked_chunks_mutex);
+		for (auto it = parked_chunks.begin(); it != parked_chunks.end();)
+		{
+			if (!reachable.contains(*it))
+			{
+				++it;
+				continue;
+			}
+
+			if (const ChunkData* chunk_data = chunk_map->get_chunk(*it))
+			{
+				chunks_to_mesh.push_back({ chunk_data->position, chunk_data->version });
+			}
+			it = parked_chunks.erase(it);
+		}
+	}
+	if (!chunks_to_mesh.empty())
+	{
+		mesh_generator_pool->queue_task(std::move(chunks_to_mesh));
 	}
 
-	// TODO: Add a better way to queue these tasks. Pipe the chunk_generator_pool to the mesh_generator_pool
-	std::vector<ChunkData*> chunk_datas = chunk_generator_pool->take_results();
-	// Remove empty and full chunks as they don't need to be generated
-	std::erase_if(chunk_datas, [](ChunkData* chunk_data)
-			{ return chunk_data->surface_state != SurfaceState::MIXED; });
-	mesh_generator_pool->queue_task(chunk_datas);
+	for (const Vector3i& chunk_pos : chunk_positions)
+	{
+		const bool is_culled = !reachable.contains(chunk_pos);
+		if (is_culled == culled_chunks.contains(chunk_pos))
+		{
+			continue;
+		}
+
+		if (is_culled)
+		{
+			culled_chunks.insert(chunk_pos);
+			set_chunk_visible(chunk_pos, false);
+		}
+		else
+		{
+			culled_chunks.erase(chunk_pos);
+			set_chunk_visible(chunk_pos, !(region_merging_active && region_meshes.is_chunk_hidden(chunk_pos)));
+		}
+	}
 }
 
-void ChunkLoader::unload_all()
+void ChunkLoader::update_chunk_interest()
 {
-	if (chunk_map)
+	std::vector<Vector3i> released;
+	chunk_interest.set_throughput(chunks_per_second);
+	chunk_interest.update(released);
+	if (released.empty())
 	{
-		chunk_map->unload_all();
+		return;
 	}
-	if (chunk_viewer)
+
+	// Mostly prefetched chunks off a path the viewer didn't take, their queued work is dropped before they're unloaded
+	const std::unordered_set<Vector3i, Vector3iHasher> released_set(released.begin(), released.end());
+	auto is_released = [&released_set](const ChunkTask& chunk_task)
+	{ return released_set.contains(chunk_task.position); };
+	chunk_generator_pool->cancel_tasks(is_released);
+	mesh_generator_pool->cancel_tasks(is_released);
+
+	for (const Vector3i& chunk_pos : released)
 	{
-		chunk_viewer->reset();
+		leading_edge_due.erase(chunk_pos);
 	}
+	unload_chunks(released);
 }
 
-void ChunkLoader::modify_terrain(Vector3 global_position, bool is_subtract)
+void ChunkLoader::update_leading_edge()
 {
-	Vector3i chunk_pos = Vector3i(
-			(int)Math::floor(global_position.x / CHUNK_SIZE),
-			(int)Math::floor(global_position.y / CHUNK_SIZE),
-			(int)Math::floor(global_position.z / CHUNK_SIZE));
-	ChunkData* chunk_data = chunk_map->get_chunk(chunk_pos);
-	if (!chunk_data)
+	ChunkViewer* chunk_viewer = get_chunk_viewer();
+	if (!chunk_viewer)
+	{
+		leading_edge_due.clear();
+		has_leading_edge = false;
+		return;
+	}
+
+	const Vector3i chunk_pos = chunk_viewer->get_current_chunk_pos();
+	const Vector3i delta = chunk_pos - leading_edge_chunk_pos;
+	if (has_leading_edge && chunk_pos != leading_edge_chunk_pos && std::max({ std::abs(delta.x), std::abs(delta.y), std::abs(delta.z) }) <= MAX_LEADING_EDGE_STEPS)
+	{
+		// The chunks entering the sphere are due now, prefetched ones are often drawn already
+		const uint64_t now = Time::get_singleton()->get_ticks_usec();
+		const int32_t radius = ChunkInterest::get_radius(*chunk_viewer);
+		const chunk_shells::Shape shape = ChunkInterest::get_shape(*chunk_viewer);
+		Vector3i centre = leading_edge_chunk_pos;
+		while (centre != chunk_pos)
+		{
+			const Vector3i remaining = chunk_pos - centre;
+			const Vector3i step(std::clamp(remaining.x, -1, 1), std::clamp(remaining.y, -1, 1), std::clamp(remaining.z, -1, 1));
+			centre = centre + step;
+			for (const Vector3i& offset : delta_slabs::get_entering(shape, radius, step))
+			{
+				const Vector3i entering_pos = centre + offset;
+				if (get_chunk_mesh(entering_pos).is_valid())
+				{
+					++time_to_visible_samples;
+				}
+				else
+				{
+					leading_edge_due.try_emplace(entering_pos, now);
+				}
+			}
+		}
+	}
+	leading_edge_chunk_pos = chunk_pos;
+	has_leading_edge = true;
+}
+
+void ChunkLoader::mesh_became_visible(const Vector3i& p_chunk_pos)
+{
+	auto it = leading_edge_due.find(p_chunk_pos);
+	if (it == leading_edge_due.end())
 	{
-		PRINT_ERROR("can't find chunk for modification!");
 		return;
 	}
 
-	// TODO: Find/Load and Modify the surrounding chunks
+	time_to_visible_sum_usec += Time::get_singleton()->get_ticks_usec() - it->second;
+	++time_to_visible_samples;
+	leading_edge_due.erase(it);
+}
 
-	if (is_subtract && chunk_data->surface_state == SurfaceState::EMPTY)
+void ChunkLoader::update_pipeline_stats()
+{
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	if (last_pipeline_stats_usec == 0)
 	{
+		last_pipeline_stats_usec = now;
+		last_generated_chunk_count = generated_chunk_count.load(std::memory_order_relaxed);
 		return;
 	}
-	if (!is_subtract && chunk_data->surface_state == SurfaceState::FULL)
+
+	const uint64_t elapsed_usec = now - last_pipeline_stats_usec;
+	if (elapsed_usec < PIPELINE_STATS_INTERVAL_USEC)
 	{
 		return;
 	}
 
-	Vector3 position;
-	position.x = global_position.x - (float)(chunk_pos.x * CHUNK_SIZE);
-	position.y = global_position.y - (float)(chunk_pos.y * CHUNK_SIZE);
-	position.z = global_position.z - (float)(chunk_pos.z * CHUNK_SIZE);
+	constexpr float alpha = 0.5f;
 
-	float radius = 3;
-	float radius_sqr = radius * radius;
+	// An idle generator says nothing about how fast it can go, so only windows that end with work queued count
+	const uint64_t generated_count = generated_chunk_count.load(std::memory_order_relaxed);
+	if (generated_count > last_generated_chunk_count && chunk_generator_pool->get_task_count() > 0)
+	{
+		const float new_chunks_per_second = (generated_count - last_generated_chunk_count) / (elapsed_usec / 1000000.0f);
+		chunks_per_second = chunks_per_second == 0.0f ? new_chunks_per_second : (new_chunks_per_second * alpha) + (chunks_per_second * (1.0f - alpha));
+	}
+	last_generated_chunk_count = generated_count;
+
+	if (time_to_visible_samples > 0)
+	{
+		const float new_time_to_visible_msec = time_to_visible_sum_usec / (time_to_visible_samples * 1000.0f);
+		time_to_visible_msec = (new_time_to_visible_msec * alpha) + (time_to_visible_msec * (1.0f - alpha));
+		time_to_visible_sum_usec = 0;
+		time_to_visible_samples = 0;
+	}
+
+	std::erase_if(leading_edge_due, [now](const auto& entry)
+			{ return now - entry.second > LEADING_EDGE_TIMEOUT_USEC; });
 
-	// Determine local bounds
-	int x_min = CLAMP((int)Math::floor(position.x - radius), 0, POINTS_SIZE - 1);
-	int x_max = CLAMP((int)Math::floor(position.x + radius), 0, POINTS_SIZE - 1);
-	int y_min = CLAMP((int)Math::floor(position.y - radius), 0, POINTS_SIZE - 1);
-	int y_max = CLAMP((int)Math::floor(position.y + radius), 0, POINTS_SIZE - 1);
-	int z_min = CLAMP((int)Math::floor(position.z - radius), 0, POINTS_SIZE - 1);
-	int z_max = CLAMP((int)Math::floor(position.z + radius), 0, POINTS_SIZE - 1);
+	last_pipeline_stats_usec = now;
+}
 
-	for (int z = z_min; z <= z_max; ++z)
+ChunkViewer* ChunkLoader::get_chunk_viewer() const
+{
+	return Object::cast_to<ChunkViewer>(ObjectDB::get_instance(chunk_viewer_id));
+}
+
+void ChunkLoader::set_chunk_viewer(ChunkViewer* p_chunk_viewer)
+{
+	if (state == State::Ready)
 	{
-		for (int y = y_min; y <= y_max; ++y)
+		// Swap which viewer the running loader follows
+		if (ChunkViewer* previous = get_chunk_viewer())
 		{
-			for (int x = x_min; x <= x_max; ++x)
+			remove_viewer(previous);
+		}
+		add_viewer(p_chunk_viewer);
+	}
+	chunk_viewer_id = p_chunk_viewer ? p_chunk_viewer->get_instance_id() : 0;
+}
+
+void ChunkLoader::add_viewer(ChunkViewer* p_viewer)
+{
+	chunk_interest.add_viewer(p_viewer);
+	collision_interest.add_body(p_viewer, CHUNK_SIZE);
+}
+
+void ChunkLoader::remove_viewer(ChunkViewer* p_viewer)
+{
+	chunk_interest.remove_viewer(p_viewer);
+	collision_interest.remove_body(p_viewer);
+}
+
+void ChunkLoader::add_collision_body(Node3D* p_body, float p_radius)
+{
+	collision_interest.add_body(p_body, p_radius);
+}
+
+void ChunkLoader::remove_collision_body(Node3D* p_body)
+{
+	collision_interest.remove_body(p_body);
+}
+
+static Dictionary ray_hit_to_dictionary(const TerrainRayHit& p_hit)
+{
+	Dictionary result;
+	if (p_hit.hit)
+	{
+		result["position"] = p_hit.position;
+		result["normal"] = p_hit.normal;
+		result["distance"] = p_hit.distance;
+	}
+	return result;
+}
+
+Dictionary ChunkLoader::raycast(Vector3 p_from, Vector3 p_to)
+{
+	TerrainRaycast terrain_raycast(chunk_map.get(), height_range_oracle.get());
+	return ray_hit_to_dictionary(terrain_raycast.raycast(p_from, p_to));
+}
+
+Dictionary ChunkLoader::sphere_cast(Vector3 p_from, Vector3 p_to, float p_radius)
+{
+	TerrainRaycast terrain_raycast(chunk_map.get(), height_range_oracle.get());
+	return ray_hit_to_dictionary(terrain_raycast.sphere_cast(p_from, p_to, p_radius));
+}
+
+Dictionary ChunkLoader::raycast_batch(const PackedVector3Array& p_from, const PackedVector3Array& p_to)
+{
+	return cast_batch(p_from, p_to, 0.0f);
+}
+
+Dictionary ChunkLoader::sphere_cast_batch(const PackedVector3Array& p_from, const PackedVector3Array& p_to, float p_radius)
+{
+	return cast_batch(p_from, p_to, p_radius);
+}
+
+Dictionary ChunkLoader::cast_batch(const PackedVector3Array& p_from, const PackedVector3Array& p_to, float p_radius)
+{
+	if (p_from.size() != p_to.size())
+	{
+		PRINT_ERROR("from and to must be the same size!");
+		return Dictionary();
+	}
+
+	const int64_t count = p_from.size();
+	PackedVector3Array positions;
+	PackedVector3Array normals;
+	PackedFloat32Array distances;
+	positions.resize(count);
+	normals.resize(count);
+	distances.resize(count);
+
+	{
+		std::lock_guard lock(cast_batch_mutex);
+		cast_batch_data.from = p_from.ptr();
+		cast_batch_data.to = p_to.ptr();
+		cast_batch_data.radius = p_radius;
+		cast_batch_data.count = count;
+		cast_batch_data.positions = positions.ptrw();
+		cast_batch_data.normals = normals.ptrw();
+		cast_batch_data.distances = distances.ptrw();
+
+		const int64_t task_count = (count + CASTS_PER_TASK - 1) / CASTS_PER_TASK;
+		if (task_count == 1)
+		{
+			_process_cast_batch(0); // Not worth the thread overhead
+		}
+		else if (task_count > 1)
+		{
+			WorkerThreadPool* worker_thread_pool = WorkerThreadPool::get_singleton();
+			Callable task_func = callable_mp(this, &ChunkLoader::_process_cast_batch);
+			int64_t group_id = worker_thread_pool->add_group_task(task_func, task_count, -1, true, "Terrain cast batch");
+			worker_thread_pool->wait_for_group_task_completion(group_id);
+		}
+
+		cast_batch_data = CastBatch{};
+	}
+
+	Dictionary result;
+	result["positions"] = positions;
+	result["normals"] = normals;
+	result["distances"] = distances;
+	return result;
+}
+
+void ChunkLoader::_process_cast_batch(uint32_t p_task_index)
+{
+	const CastBatch& batch = cast_batch_data;
+	const int64_t begin = static_cast<int64_t>(p_task_index) * CASTS_PER_TASK;
+	const int64_t end = std::min<int64_t>(begin + CASTS_PER_TASK, batch.count);
+
+	TerrainRaycast terrain_raycast(chunk_map.get(), height_range_oracle.get());
+	for (int64_t i = begin; i < end; ++i)
+	{
+		TerrainRayHit hit = terrain_raycast.sphere_cast(batch.from[i], batch.to[i], batch.radius);
+		batch.positions[i] = hit.position;
+		batch.normals[i] = hit.normal;
+		batch.distances[i] = hit.hit ? hit.distance : -1.0f;
+	}
+}
+
+void ChunkLoader::unload_all()
+{
+	std::vector<Vector3i> chunk_positions;
+	get_drawn_chunk_positions(chunk_positions);
+	for (const Vector3i& chunk_pos : chunk_positions)
+	{
+		release_chunk(chunk_pos);
+	}
+	region_meshes.clear();
+	collision_updates.clear();
+
+	{
+		std::lock_guard lock(parked_chunks_mutex);
+		parked_chunks.clear();
+	}
+	culled_chunks.clear();
+	cave_culling.clear();
+	cave_culling_reachable.reset();
+	applied_cave_culling_id = cave_culling.get_result_id();
+	cave_culling_dirty = true;
+	leading_edge_due.clear();
+
+	if (chunk_map)
+	{
+		chunk_map->unload_all();
+	}
+	chunk_interest.reset_cursors();
+}
+
+void ChunkLoader::modify_terrain(Vector3 global_position, bool is_subtract)
+{
+	constexpr float radius = 3;
+	constexpr float radius_sqr = radius * radius;
+	const uint8_t new_value = is_subtract ? 0 : 255;
+
+	// Neighbouring chunks share their border points, every chunk holding a point in the sphere is edited so they still match
+	const Vector3i point_min = Vector3i((global_position - Vector3(radius, radius, radius)).ceil());
+	const Vector3i point_max = Vector3i((global_position + Vector3(radius, radius, radius)).floor());
+	const Vector3i chunk_min(floor_div(point_min.x - 1, CHUNK_SIZE), floor_div(point_min.y - 1, CHUNK_SIZE), floor_div(point_min.z - 1, CHUNK_SIZE));
+	const Vector3i chunk_max(floor_div(point_max.x, CHUNK_SIZE), floor_div(point_max.y, CHUNK_SIZE), floor_div(point_max.z, CHUNK_SIZE));
+
+	// The sphere is much smaller than a chunk, so every chunk it touches is a neighbour of the centre one
+	static_assert(radius < CHUNK_SIZE);
+	const Vector3i centre_chunk_pos = Vector3i((global_position / CHUNK_SIZE).floor());
+	ConcurrentChunkMap::Neighbourhood neighbourhood;
+	chunk_map->get_neighbourhood(centre_chunk_pos, neighbourhood);
+
+	bool found_chunk = false;
+	for (int32_t chunk_z = chunk_min.z; chunk_z <= chunk_max.z; ++chunk_z)
+	{
+		for (int32_t chunk_y = chunk_min.y; chunk_y <= chunk_max.y; ++chunk_y)
+		{
+			for (int32_t chunk_x = chunk_min.x; chunk_x <= chunk_max.x; ++chunk_x)
 			{
-				int index = x + (y * POINTS_SIZE) + (z * POINTS_AREA);
+				const Vector3i chunk_pos(chunk_x, chunk_y, chunk_z);
+				const Vector3i offset = chunk_pos - centre_chunk_pos + Vector3i(1, 1, 1);
+				const ChunkData* source = neighbourhood[offset.x + offset.y * 3 + offset.z * 9];
 
-				// Sphere distance check
-				Vector3 voxel_pos(x, y, z);
-				float dist_sqr = voxel_pos.distance_squared_to(position);
-				if (dist_sqr <= radius_sqr)
+				// Published chunks are never written to, the edit goes to a copy that replaces it, see acquire_snapshot
+				ChunkData* snapshot = nullptr;
+				if (!source && height_range_oracle)
+				{
+					// All air or all rock chunks are never created, make the one being edited
+					const SurfaceState surface_state = height_range_oracle->classify(chunk_pos);
+					if (surface_state != SurfaceState::MIXED)
+					{
+						snapshot = chunk_map->acquire_snapshot(chunk_pos);
+						HeightRangeOracle::fill_uniform(*snapshot, surface_state);
+					}
+				}
+				const ChunkData* chunk_data = snapshot ? snapshot : source;
+				if (!chunk_data)
+				{
+					continue;
+				}
+				found_chunk = true;
+
+				if (!chunk_data->is_generated.load(std::memory_order_acquire))
+				{
+					continue; // Still on a generator thread, there's nothing to edit yet
+				}
+				if ((is_subtract && chunk_data->surface_state == SurfaceState::EMPTY) || (!is_subtract && chunk_data->surface_state == SurfaceState::FULL))
 				{
-					uint8_t old_value = chunk_data->points[index];
-					uint8_t new_value = is_subtract ? 0 : 255;
+					if (snapshot)
+					{
+						chunk_map->discard_snapshot(snapshot);
+					}
+					continue;
+				}
+
+				const Vector3 position = global_position - Vector3(chunk_pos * CHUNK_SIZE);
+
+				// Determine local bounds
+				int x_min = CLAMP((int)Math::floor(position.x - radius), 0, POINTS_SIZE - 1);
+				int x_max = CLAMP((int)Math::floor(position.x + radius), 0, POINTS_SIZE - 1);
+				int y_min = CLAMP((int)Math::floor(position.y - radius), 0, POINTS_SIZE - 1);
+				int y_max = CLAMP((int)Math::floor(position.y + radius), 0, POINTS_SIZE - 1);
+				int z_min = CLAMP((int)Math::floor(position.z - radius), 0, POINTS_SIZE - 1);
+				int z_max = CLAMP((int)Math::floor(position.z + radius), 0, POINTS_SIZE - 1);
 
-					chunk_data->surface_sum += new_value - old_value;
+				bool is_changed = false;
+				for (int z = z_min; z <= z_max; ++z)
+				{
+					for (int y = y_min; y <= y_max; ++y)
+					{
+						for (int x = x_min; x <= x_max; ++x)
+						{
+							int index = x + (y * POINTS_SIZE) + (z * POINTS_AREA);
+
+							// Sphere distance check
+							Vector3 voxel_pos(x, y, z);
+							float dist_sqr = voxel_pos.distance_squared_to(position);
+							if (dist_sqr <= radius_sqr && chunk_data->points[index] != new_value)
+							{
+								// Only copied once a point actually changes
+								if (!snapshot)
+								{
+									snapshot = chunk_map->acquire_snapshot(chunk_pos, source);
+									chunk_data = snapshot;
+								}
+								snapshot->surface_sum += new_value - snapshot->points[index];
+								snapshot->points[index] = new_value;
+								is_changed = true;
+							}
+						}
+					}
+				}
 
-					chunk_data->points[index] = new_value;
+				if (is_changed)
+				{
+					update_surface_state(*snapshot);
+					chunk_map->publish_snapshot(snapshot); // Meshed again once per frame, see remesh_dirty_chunks
+				}
+				else if (snapshot)
+				{
+					chunk_map->discard_snapshot(snapshot);
 				}
 			}
 		}
 	}
 
-	if (chunk_data->surface_sum == 0)
+	if (!found_chunk)
 	{
-		chunk_data->surface_state = SurfaceState::EMPTY;
+		PRINT_ERROR("can't find chunk for modification!");
 	}
-	else if (chunk_data->surface_sum == (float)POINTS_VOLUME)
+}
+
+void ChunkLoader::remesh_dirty_chunks()
+{
+	const std::vector<Vector3i> dirty_chunks = chunk_map->consume_dirty_list();
+	if (dirty_chunks.empty())
 	{
-		chunk_data->surface_state = SurfaceState::FULL;
+		return;
 	}
-	else
+	// Edits can open or close paths, filling a chunk in or digging it out too
+	cave_culling_dirty = true;
+
+	// Meshes still queued for these are of older versions, they'd only be dropped once they're done
+	const std::unordered_set<Vector3i, Vector3iHasher> dirty_set(dirty_chunks.begin(), dirty_chunks.end());
+	mesh_generator_pool->cancel_tasks([&dirty_set](const ChunkTask& p_queued)
+			{ return dirty_set.contains(p_queued.position); });
+
+	const EpochManager::Pin pin = chunk_map->pin();
+	std::vector<ChunkTask> chunks_to_mesh;
+	for (const Vector3i& chunk_pos : dirty_chunks)
 	{
-		chunk_data->surface_state = SurfaceState::MIXED;
+		ChunkData* chunk_data = chunk_map->get_chunk(chunk_pos);
+		if (chunk_data->surface_state == SurfaceState::MIXED)
+		{
+			chunks_to_mesh.push_back({ chunk_pos, chunk_data->version });
+		}
+		else
+		{
+			// Dug out or filled in, an empty mesh removes what was drawn and its collision
+			MeshData empty_mesh_data{};
+			empty_mesh_data.chunk_pos = chunk_pos;
+			empty_mesh_data.chunk_version = chunk_data->version;
+			mesh_datas.push_back(empty_mesh_data);
+		}
 	}
 
-	mesh_generator_pool->queue_task(chunk_data, true);
+	if (!chunks_to_mesh.empty())
+	{
+		mesh_generator_pool->queue_task(std::move(chunks_to_mesh), true);
+	}
 }
 
 Chunk* ChunkLoader::get_chunk(Vector3i chunk_pos)
@@ -404,10 +1285,20 @@ Chunk* ChunkLoader::get_chunk(Vector3i chunk_pos)
 		return it->value;
 	}
 
-	Chunk* chunk = memnew(Chunk);
+	Chunk* chunk = nullptr;
+	if (!chunk_node_pool.empty())
+	{
+		chunk = chunk_node_pool.back();
+		chunk_node_pool.pop_back();
+		chunk->set_visible(true);
+	}
+	else
+	{
+		chunk = memnew(Chunk);
+		chunk->set_material(material);
+	}
 
 	chunk->set_position(chunk_pos * CHUNK_SIZE);
-	chunk->set_material(material);
 
 #ifdef DEBUG_ENABLED
 	// The node name shouldn't be needed in release so we can skip it for a negligible speed increase
@@ -416,8 +1307,182 @@ Chunk* ChunkLoader::get_chunk(Vector3i chunk_pos)
 	chunk->set_name(buffer);
 #endif
 
-	add_child(chunk);
+	if (!chunk->is_inside_tree())
+	{
+		add_child(chunk);
+	}
 	chunk_node_map[chunk_pos] = chunk;
 
 	return chunk;
 }
+
+void ChunkLoader::release_chunk(const Vector3i& p_chunk_pos)
+{
+	Ref<ArrayMesh> mesh;
+	Ref<ConcavePolygonShape3D> shape;
+	culled_chunks.erase(p_chunk_pos);
+
+	if (server_rids_active)
+	{
+		server_chunk_store.release_slot(p_chunk_pos, mesh, shape);
+	}
+	else
+	{
+		auto it = chunk_node_map.find(p_chunk_pos);
+		if (it == chunk_node_map.end())
+		{
+			return;
+		}
+
+		Chunk* chunk = it->value;
+		mesh = chunk->get_mesh();
+		shape = chunk->get_collision_shape();
+		chunk->reset();
+
+		chunk_node_pool.push_back(chunk);
+		chunk_node_map.erase(p_chunk_pos);
+	}
+
+	array_mesh_pool->release(mesh);
+	collision_shape_pool->release(shape);
+	drawn_mesh_versions.erase(p_chunk_pos);
+}
+
+void ChunkLoader::unload_chunks(const std::vector<Vector3i>& p_chunk_positions)
+{
+	for (const Vector3i& chunk_pos : p_chunk_positions)
+	{
+		release_chunk(chunk_pos);
+		if (region_merging_active)
+		{
+			// An empty mesh takes it out of its regions
+			MeshData empty_mesh_data{};
+			empty_mesh_data.chunk_pos = chunk_pos;
+			region_meshes.chunk_mesh_changed(empty_mesh_data);
+		}
+		collision_updates.erase(chunk_pos);
+	}
+	{
+		std::lock_guard lock(parked_chunks_mutex);
+		for (const Vector3i& chunk_pos : p_chunk_positions)
+		{
+			parked_chunks.erase(chunk_pos);
+		}
+	}
+	chunk_map->unload_many(p_chunk_positions);
+}
+
+void ChunkLoader::apply_chunk_mesh(const MeshData& p_mesh_data)
+{
+	const Vector3i chunk_pos = p_mesh_data.chunk_pos;
+	if (p_mesh_data.array_mesh.is_null() && !chunk_has_collision(chunk_pos))
+	{
+		release_chunk(chunk_pos); // Nothing left to draw or collide with
+		return;
+	}
+
+	Ref<ArrayMesh> previous_mesh = get_chunk_mesh(chunk_pos);
+	if (server_rids_active)
+	{
+		server_chunk_store.update_chunk_mesh(p_mesh_data);
+	}
+	else
+	{
+		get_chunk(chunk_pos)->update_chunk_mesh(p_mesh_data);
+	}
+
+	if (previous_mesh != p_mesh_data.array_mesh)
+	{
+		array_mesh_pool->release(previous_mesh);
+	}
+	drawn_mesh_versions[chunk_pos] = p_mesh_data.chunk_version;
+}
+
+void ChunkLoader::apply_chunk_collision(const CollisionData& p_collision_data)
+{
+	Ref<ConcavePolygonShape3D> previous_shape = get_chunk_collision_shape(p_collision_data.chunk_pos);
+	if (server_rids_active)
+	{
+		server_chunk_store.update_chunk_collision(p_collision_data);
+	}
+	else
+	{
+		get_chunk(p_collision_data.chunk_pos)->update_chunk_collision(p_collision_data);
+	}
+
+	if (previous_shape != p_collision_data.collision_shape)
+	{
+		collision_shape_pool->release(previous_shape);
+	}
+}
+
+MeshData ChunkLoader::get_drawn_mesh_data(const Vector3i& p_chunk_pos) const
+{
+	MeshData mesh_data{};
+	mesh_data.chunk_pos = p_chunk_pos;
+	mesh_data.array_mesh = get_chunk_mesh(p_chunk_pos);
+	auto it = drawn_mesh_versions.find(p_chunk_pos);
+	if (it != drawn_mesh_versions.end())
+	{
+		mesh_data.chunk_version = it->second;
+	}
+	return mesh_data;
+}
+
+Ref<ArrayMesh> ChunkLoader::get_chunk_mesh(const Vector3i& p_chunk_pos) const
+{
+	if (server_rids_active)
+	{
+		return server_chunk_store.get_mesh(p_chunk_pos);
+	}
+
+	auto it = chunk_node_map.find(p_chunk_pos);
+	return it != chunk_node_map.end() ? it->value->get_mesh() : Ref<ArrayMesh>();
+}
+
+Ref<ConcavePolygonShape3D> ChunkLoader::get_chunk_collision_shape(const Vector3i& p_chunk_pos) const
+{
+	if (server_rids_active)
+	{
+		return server_chunk_store.get_collision_shape(p_chunk_pos);
+	}
+
+	auto it = chunk_node_map.find(p_chunk_pos);
+	return it != chunk_node_map.end() ? it->value->get_collision_shape() : Ref<ConcavePolygonShape3D>();
+}
+
+bool ChunkLoader::chunk_has_collision(const Vector3i& p_chunk_pos) const
+{
+	if (server_rids_active)
+	{
+		return server_chunk_store.has_collision(p_chunk_pos);
+	}
+
+	auto it = chunk_node_map.find(p_chunk_pos);
+	return it != chunk_node_map.end() && it->value->has_collision();
+}
+
+void ChunkLoader::set_chunk_visible(const Vector3i& p_chunk_pos, bool p_visible)
+{
+	if (server_rids_active)
+	{
+		server_chunk_store.set_visible(p_chunk_pos, p_visible);
+		return;
+	}
+
+	auto it = chunk_node_map.find(p_chunk_pos);
+	if (it != chunk_node_map.end())
+	{
+		it->value->set_mesh_visible(p_visible);
+	}
+}
+
+void ChunkLoader::get_drawn_chunk_positions(std::vector<Vector3i>& r_chunk_positions) const
+{
+	r_chunk_positions.reserve(r_chunk_positions.size() + chunk_node_map.size());
+	for (const KeyValue<Vector3i, Chunk*>& chunk_node : chunk_node_map)
+	{
+		r_chunk_positions.push_back(chunk_node.key);
+	}
+	server_chunk_store.get_chunk_positions(r_chunk_positions);
+}
@@ -1,24 +1,44 @@
 #pragma once
 
+#include "cave_culling.h"
 #include "chunk.h"
 #include "chunk_data.h"
 #include "chunk_generator.h"
+#include "chunk_interest.h"
 #include "chunk_viewer.h"
 #include "collision_generator.h"
+#include "collision_interest.h"
 #include "concurrent_chunk_map.h"
+#include "frame_budget.h"
+#include "height_range_oracle.h"
 #include "mesh_generator.h"
+#include "region_mesh_generator.h"
+#include "region_meshes.h"
+#include "resource_pool.h"
+#include "server_chunk_store.h"
+#include "terrain_raycast.h"
 #include "thread_pool.h"
 
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/concave_polygon_shape3d.hpp>
 #include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/classes/ref.hpp>
 #include <godot_cpp/classes/standard_material3d.hpp>
 #include <godot_cpp/classes/wrapped.hpp>
 #include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
 #include <godot_cpp/variant/vector3.hpp>
 #include <godot_cpp/variant/vector3i.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using namespace godot;
@@ -46,24 +66,68 @@ public:
 	bool can_stop() const { return state == State::Ready; }
 
 	Ref<ChunkGeneratorSettings> chunk_generator_settings;
-	ChunkViewer* chunk_viewer = nullptr; // TODO: Use a ObjectID instead. Using raw pointer isn't safe as it could become dangling.
+	// Rendering is centred on this viewer: apply order, region merging and cave culling. It also loads chunks like any other viewer
+	ChunkViewer* get_chunk_viewer() const;
+	void set_chunk_viewer(ChunkViewer* p_chunk_viewer);
+
+	// Any number of viewers can load and keep chunks around them, e.g. the players on a server. See ChunkInterest
+	void add_viewer(ChunkViewer* p_viewer);
+	void remove_viewer(ChunkViewer* p_viewer);
 
 	State get_state() const { return state; }
 
 	void modify_terrain(Vector3 global_position, bool is_subtract = false);
 
+	// Collision is only built for chunks near registered bodies. Registering an already registered body updates its radius
+	void add_collision_body(Node3D* p_body, float p_radius);
+	void remove_collision_body(Node3D* p_body);
+
+	// Queries against the voxel data, these don't need collision to exist. Unloaded chunks count as air
+	// Single queries return an empty Dictionary on a miss, or position, normal and distance on a hit
+	Dictionary raycast(Vector3 p_from, Vector3 p_to);
+	Dictionary sphere_cast(Vector3 p_from, Vector3 p_to, float p_radius);
+	// Batches are split across the WorkerThreadPool. They return positions, normals and distances arrays, a miss has a distance of -1
+	Dictionary raycast_batch(const PackedVector3Array& p_from, const PackedVector3Array& p_to);
+	Dictionary sphere_cast_batch(const PackedVector3Array& p_from, const PackedVector3Array& p_to, float p_radius);
+
 	std::weak_ptr<ConcurrentChunkMap> get_chunk_map() const { return chunk_map; }
 	int64_t get_pending_chunks_count() const { return chunk_generator_pool.is_valid() ? chunk_generator_pool->get_task_count() : 0; }
 	int64_t get_pending_mesh_tasks_count() const { return mesh_generator_pool.is_valid() ? mesh_generator_pool->get_task_count() : 0; }
 	int64_t get_mesh_datas_count() const { return mesh_datas.size(); }
+	const FrameBudget& get_frame_budget() const { return frame_budget; }
+	const ChunkInterest& get_chunk_interest() const { return chunk_interest; }
+	int64_t get_culled_chunks_count() const { return culled_chunks.size(); }
+	float get_time_to_visible_msec() const { return time_to_visible_msec; }
 
 	Ref<StandardMaterial3D> material;
 
+	// Draw and collide chunks through RenderingServer and PhysicsServer3D RIDs instead of Chunk nodes. Read on init
+	bool use_server_rids = false;
+
+	// Distant chunks are merged into region meshes to cut draw calls, see RegionMeshes. Read on init.
+	// Off by default, it keeps a CPU copy of every drawn chunk's vertex arrays to merge from, on top of the region
+	// meshes themselves
+	bool region_merging = false;
+	float region_near_distance = 4.0f;
+	float region_far_distance = 12.0f;
+
+	// Chunks with no open path to the viewer aren't meshed or drawn, see CaveCulling. Read on init
+	bool cull_caves = true;
+
+	// Chunks the generator would fill with only air or only rock aren't created at all, see HeightRangeOracle. Read on init
+	bool cull_height_range = true;
+
+	// Collision meshes are simplified on the collision threads, see MeshSimplifier
+	int64_t collision_triangle_budget = 0;
+	float collision_max_error = 0.25f;
+	// Collision shapes are swapped in _physics_process, at most this many per tick
+	int64_t collision_updates_per_tick = 16;
+
 protected:
 	static void _bind_methods();
 
-	ChunkViewer* get_chunk_viewer() const { return chunk_viewer; }
-	void set_chunk_viewer(ChunkViewer* p_chunk_viewer) { chunk_viewer = p_chunk_viewer; }
+	void _exit_tree() override;
+	void _physics_process(double p_delta) override;
 
 	Ref<ChunkGeneratorSettings> get_chunk_generator_settings() const { return chunk_generator_settings; }
 	void set_chunk_generator_settings(Ref<ChunkGeneratorSettings> p_chunk_generator_settings) { chunk_generator_settings = p_chunk_generator_settings; }
@@ -71,25 +135,160 @@ protected:
 	Ref<StandardMaterial3D> get_material() const { return material; }
 	void set_material(Ref<StandardMaterial3D> p_material) { material = p_material; }
 
+	bool get_use_server_rids() const { return use_server_rids; }
+	void set_use_server_rids(bool p_use_server_rids) { use_server_rids = p_use_server_rids; }
+
+	bool get_region_merging() const { return region_merging; }
+	void set_region_merging(bool p_region_merging) { region_merging = p_region_merging; }
+
+	float get_region_near_distance() const { return region_near_distance; }
+	void set_region_near_distance(float p_region_near_distance) { region_near_distance = p_region_near_distance; }
+
+	float get_region_far_distance() const { return region_far_distance; }
+	void set_region_far_distance(float p_region_far_distance) { region_far_distance = p_region_far_distance; }
+
+	bool get_cull_caves() const { return cull_caves; }
+	void set_cull_caves(bool p_cull_caves) { cull_caves = p_cull_caves; }
+
+	bool get_cull_height_range() const { return cull_height_range; }
+	void set_cull_height_range(bool p_cull_height_range) { cull_height_range = p_cull_height_range; }
+
+	int64_t get_collision_triangle_budget() const { return collision_triangle_budget; }
+	void set_collision_triangle_budget(int64_t p_collision_triangle_budget) { collision_triangle_budget = p_collision_triangle_budget; }
+
+	float get_collision_max_error() const { return collision_max_error; }
+	void set_collision_max_error(float p_collision_max_error) { collision_max_error = p_collision_max_error; }
+
+	int64_t get_collision_updates_per_tick() const { return collision_updates_per_tick; }
+	void set_collision_updates_per_tick(int64_t p_collision_updates_per_tick) { collision_updates_per_tick = p_collision_updates_per_tick; }
+
 private:
 	Chunk* get_chunk(Vector3i chunk_pos);
+	// Returns the chunk's node or slot, mesh and shape to the recycle pools
+	void release_chunk(const Vector3i& p_chunk_pos);
+	// Releases the chunks and drops their data, for chunks no viewer wants anymore
+	void unload_chunks(const std::vector<Vector3i>& p_chunk_positions);
+
+	// Route to either the Chunk nodes or the server_chunk_store
+	void apply_chunk_mesh(const MeshData& p_mesh_data);
+	void apply_chunk_collision(const CollisionData& p_collision_data);
+	Ref<ArrayMesh> get_chunk_mesh(const Vector3i& p_chunk_pos) const;
+	// The drawn mesh with the version it was built from, for collision built from it
+	MeshData get_drawn_mesh_data(const Vector3i& p_chunk_pos) const;
+	Ref<ConcavePolygonShape3D> get_chunk_collision_shape(const Vector3i& p_chunk_pos) const;
+	bool chunk_has_collision(const Vector3i& p_chunk_pos) const;
+	void set_chunk_visible(const Vector3i& p_chunk_pos, bool p_visible);
+	void get_drawn_chunk_positions(std::vector<Vector3i>& r_chunk_positions) const;
+
+	void update_chunk_interest();
+	void update_leading_edge();
+	void mesh_became_visible(const Vector3i& p_chunk_pos);
+	void update_pipeline_stats();
+	void update_regions();
+
+	void update_cave_culling();
+	void _update_cave_culling();
+	void apply_cave_culling();
+
+	// Queues one mesh task per chunk edited since the last frame
+	void remesh_dirty_chunks();
 
 	void try_update_chunks();
 	void _update_chunks();
 
+	void apply_meshes(FrameBudget::Priority p_priority);
+
+	void update_collision_interest();
+	void queue_collision(const MeshData& p_mesh_data);
+	void take_collision_results();
+
+	Dictionary cast_batch(const PackedVector3Array& p_from, const PackedVector3Array& p_to, float p_radius);
+	void _process_cast_batch(uint32_t p_task_index);
+
 	State state = State::Stopped;
 
+	uint64_t chunk_viewer_id = 0;
+	ChunkInterest chunk_interest{};
+
 	std::shared_ptr<ConcurrentChunkMap> chunk_map;
+	// Null when cull_height_range was off at init. Shared with the worker threads
+	std::shared_ptr<const HeightRangeOracle> height_range_oracle;
 
 	HashMap<Vector3i, Chunk*> chunk_node_map{};
+	std::vector<Chunk*> chunk_node_pool{}; // Released chunks, hidden but still in the tree
+
+	// Shared with the generator threads
+	std::shared_ptr<ResourcePool<ArrayMesh>> array_mesh_pool;
+	std::shared_ptr<ResourcePool<ConcavePolygonShape3D>> collision_shape_pool;
+	ServerChunkStore server_chunk_store{};
+	bool server_rids_active = false; // use_server_rids at the time of init
 	std::vector<MeshData> mesh_datas{};
+	std::unordered_map<Vector3i, uint64_t, Vector3iHasher> drawn_mesh_versions{}; // ChunkData::version of the drawn meshes
+	Vector3i last_sort_chunk_pos{};
+
+	FrameBudget frame_budget{};
 
-	using ChunkGeneratorPool = ThreadPool<ChunkGenerator, ChunkData*, ChunkData*>;
+	using ChunkGeneratorPool = ThreadPool<ChunkGenerator, ChunkTask, ChunkTask>;
 	Ref<ChunkGeneratorPool> chunk_generator_pool;
 
-	using MeshGeneratorPool = ThreadPool<MeshGenerator, ChunkData*, MeshData>;
+	using MeshGeneratorPool = ThreadPool<MeshGenerator, ChunkTask, MeshData>;
 	Ref<MeshGeneratorPool> mesh_generator_pool;
 
+	using RegionMeshGeneratorPool = ThreadPool<RegionMeshGenerator, RegionMeshTask, RegionMeshData>;
+	Ref<RegionMeshGeneratorPool> region_mesh_generator_pool;
+	RegionMeshes region_meshes{};
+	bool region_merging_active = false; // region_merging at the time of init
+
+	CaveCulling cave_culling{};
+	bool cave_culling_active = false; // cull_caves at the time of init
+	std::atomic<bool> cave_culling_running = false;
+	std::atomic<bool> cave_culling_dirty = false; // Chunks were generated since the last search
+	Vector3i cave_culling_origin{};
+	uint64_t last_cave_culling_usec = 0;
+	uint64_t applied_cave_culling_id = 0;
+	std::shared_ptr<const CaveCulling::ChunkSet> cave_culling_reachable{}; // The result applied on the main thread
+	std::unordered_set<Vector3i, Vector3iHasher> culled_chunks{}; // Drawn chunks hidden because they're out of reach
+	// Generated chunks that weren't meshed because they were out of reach, shared with _update_chunks
+	std::unordered_set<Vector3i, Vector3iHasher> parked_chunks{};
+	std::mutex parked_chunks_mutex{};
+
+	std::atomic<bool> update_chunks_running = false; // _update_chunks is queued or running on the WorkerThreadPool
+
+	// Generator throughput, measured while it has work and used to size the prefetching
+	std::atomic<uint64_t> generated_chunk_count = 0;
+	uint64_t last_generated_chunk_count = 0;
+	uint64_t last_pipeline_stats_usec = 0;
+	float chunks_per_second = 0.0f;
+
+	// Chunks that entered the main viewer's sphere in the direction it moved, and when. Done once their mesh is drawn
+	std::unordered_map<Vector3i, uint64_t, Vector3iHasher> leading_edge_due{};
+	Vector3i leading_edge_chunk_pos{};
+	bool has_leading_edge = false;
+	uint64_t time_to_visible_sum_usec = 0;
+	uint64_t time_to_visible_samples = 0;
+	float time_to_visible_msec = 0.0f;
+
 	using CollisionGeneratorPool = ThreadPool<CollisionGenerator, MeshData, CollisionData>;
 	Ref<CollisionGeneratorPool> collision_generator_pool;
+
+	CollisionInterest collision_interest{};
+	// Chunks with a collision task in flight, and the ones whose mesh changed while it was in flight
+	std::unordered_set<Vector3i, Vector3iHasher> collision_pending{};
+	std::unordered_set<Vector3i, Vector3iHasher> collision_stale{};
+	// Done collision waiting for a physics tick, only the latest per chunk is kept
+	std::unordered_map<Vector3i, CollisionData, Vector3iHasher> collision_updates{};
+
+	// Shared with the WorkerThreadPool group task while a batch is running
+	struct CastBatch
+	{
+		const Vector3* from = nullptr;
+		const Vector3* to = nullptr;
+		float radius = 0.0f;
+		int64_t count = 0;
+		Vector3* positions = nullptr;
+		Vector3* normals = nullptr;
+		float* distances = nullptr;
+	};
+	CastBatch cast_batch_data{};
+	std::mutex cast_batch_mutex{};
 };
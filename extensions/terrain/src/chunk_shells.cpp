@@ -0,0 +1,46 @@
+#include "chunk_shells.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+using namespace godot;
+
+namespace chunk_shells
+{
+alignas(64) static constexpr auto SPHERE_TABLE = build_table<MAX_RADIUS, get_vertical_scale(Shape::Sphere)>();
+alignas(64) static constexpr auto HALF_HEIGHT_TABLE = build_table<MAX_RADIUS, get_vertical_scale(Shape::HalfHeight)>();
+alignas(64) static constexpr auto QUARTER_HEIGHT_TABLE = build_table<MAX_RADIUS, get_vertical_scale(Shape::QuarterHeight)>();
+
+static_assert(SPHERE_TABLE.ranges[0].end == 123, "Shell 0 is every offset within 3");
+static_assert(SPHERE_TABLE.ranges.back().end == SPHERE_TABLE.OFFSET_COUNT);
+
+static constexpr std::array<Shells, static_cast<uint64_t>(Shape::Count)> SHELLS = {
+	Shells{ SPHERE_TABLE.offsets, SPHERE_TABLE.ranges, get_vertical_scale(Shape::Sphere) },
+	Shells{ HALF_HEIGHT_TABLE.offsets, HALF_HEIGHT_TABLE.ranges, get_vertical_scale(Shape::HalfHeight) },
+	Shells{ QUARTER_HEIGHT_TABLE.offsets, QUARTER_HEIGHT_TABLE.ranges, get_vertical_scale(Shape::QuarterHeight) },
+};
+
+uint32_t Shells::get_end(int32_t p_radius) const
+{
+	return ranges[std::clamp(p_radius, MIN_RADIUS, MAX_RADIUS) - MIN_RADIUS].end;
+}
+
+bool Shells::contains(const Vector3i& p_offset, int32_t p_radius) const
+{
+	return get_length_squared(p_offset.x, p_offset.y, p_offset.z, vertical_scale) <= static_cast<int64_t>(p_radius) * p_radius;
+}
+
+uint32_t Shells::get_step_shells(const Vector3i& p_step) const
+{
+	return static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(get_length_squared(p_step.x, p_step.y, p_step.z, vertical_scale)))));
+}
+
+const Shells& get_shells(Shape p_shape)
+{
+	return SHELLS[std::min(static_cast<uint64_t>(p_shape), SHELLS.size() - 1)];
+}
+} //namespace chunk_shells
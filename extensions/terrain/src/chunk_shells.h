@@ -0,0 +1,153 @@
+#pragma once
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+// Offsets around a chunk sorted into shells by distance, built at compile time.
+// Shell 0 holds the offsets within MIN_RADIUS, shell i the ones with a length in (i + 2, i + 3], so the shape of radius r
+// is the first r - MIN_RADIUS + 1 shells and every radius up to MAX_RADIUS shares one table.
+// The flattened shapes scale the vertical axis before measuring, for height field worlds where little is above or below.
+namespace chunk_shells
+{
+struct ChunkOffset
+{
+	int32_t x, y, z;
+
+	// Implicitly convert to Vector3i
+	inline operator godot::Vector3i() const { return godot::Vector3i(x, y, z); }
+};
+
+struct ShellRange
+{
+	uint32_t start;
+	uint32_t end;
+};
+
+enum class Shape : uint8_t
+{
+	Sphere,
+	HalfHeight, // Half as tall as it is wide
+	QuarterHeight,
+	Count
+};
+
+constexpr int32_t MIN_RADIUS = 3;
+constexpr int32_t MAX_RADIUS = 32;
+
+constexpr int32_t get_vertical_scale(Shape p_shape)
+{
+	return p_shape == Shape::QuarterHeight ? 4 : p_shape == Shape::HalfHeight ? 2 : 1;
+}
+
+constexpr int64_t get_length_squared(int32_t p_x, int32_t p_y, int32_t p_z, int32_t p_vertical_scale)
+{
+	const int64_t y = static_cast<int64_t>(p_y) * p_vertical_scale;
+	return static_cast<int64_t>(p_x) * p_x + y * y + static_cast<int64_t>(p_z) * p_z;
+}
+
+// Largest z with p_x, p_y, z inside p_radius, or -1 if the row is empty
+constexpr int32_t get_row_extent(int32_t p_x, int32_t p_y, int32_t p_radius, int32_t p_vertical_scale)
+{
+	const int64_t remaining = static_cast<int64_t>(p_radius) * p_radius - get_length_squared(p_x, p_y, 0, p_vertical_scale);
+	int32_t z = -1;
+	while (static_cast<int64_t>(z + 1) * (z + 1) <= remaining)
+	{
+		++z;
+	}
+	return z;
+}
+
+constexpr uint32_t count_offsets(int32_t p_radius, int32_t p_vertical_scale)
+{
+	const int32_t height = p_radius / p_vertical_scale;
+	uint32_t count = 0;
+	for (int32_t x = -p_radius; x <= p_radius; ++x)
+	{
+		for (int32_t y = -height; y <= height; ++y)
+		{
+			const int32_t extent = get_row_extent(x, y, p_radius, p_vertical_scale);
+			count += extent >= 0 ? extent * 2 + 1 : 0;
+		}
+	}
+	return count;
+}
+
+template <int32_t Radius, int32_t VerticalScale>
+struct Table
+{
+	static_assert(Radius >= MIN_RADIUS);
+	static constexpr uint32_t SHELL_COUNT = Radius - MIN_RADIUS + 1;
+	static constexpr uint32_t OFFSET_COUNT = count_offsets(Radius, VerticalScale);
+
+	std::array<ShellRange, SHELL_COUNT> ranges{};
+	std::array<ChunkOffset, OFFSET_COUNT> offsets{};
+};
+
+// Counting sort on the squared length, offsets of the same length keep x, y, z order
+template <int32_t Radius, int32_t VerticalScale>
+constexpr Table<Radius, VerticalScale> build_table()
+{
+	constexpr int64_t RADIUS_SQ = static_cast<int64_t>(Radius) * Radius;
+	constexpr int32_t HEIGHT = Radius / VerticalScale;
+
+	// Only the rows within the radius are walked, the constant evaluators are slow
+	std::array<uint32_t, RADIUS_SQ + 2> starts{};
+	for (int32_t x = -Radius; x <= Radius; ++x)
+	{
+		for (int32_t y = -HEIGHT; y <= HEIGHT; ++y)
+		{
+			const int64_t row_length_sq = get_length_squared(x, y, 0, VerticalScale);
+			const int32_t extent = get_row_extent(x, y, Radius, VerticalScale);
+			for (int32_t z = -extent; z <= extent; ++z)
+			{
+				++starts[row_length_sq + z * z + 1];
+			}
+		}
+	}
+	for (int64_t i = 1; i < RADIUS_SQ + 2; ++i)
+	{
+		starts[i] += starts[i - 1];
+	}
+
+	Table<Radius, VerticalScale> table{};
+	for (uint32_t shell = 0; shell < table.SHELL_COUNT; ++shell)
+	{
+		const int64_t shell_radius = shell + MIN_RADIUS;
+		const int64_t inner_radius = shell_radius - 1;
+		table.ranges[shell] = ShellRange{ shell == 0 ? 0 : starts[inner_radius * inner_radius + 1], starts[shell_radius * shell_radius + 1] };
+	}
+
+	for (int32_t x = -Radius; x <= Radius; ++x)
+	{
+		for (int32_t y = -HEIGHT; y <= HEIGHT; ++y)
+		{
+			const int64_t row_length_sq = get_length_squared(x, y, 0, VerticalScale);
+			const int32_t extent = get_row_extent(x, y, Radius, VerticalScale);
+			for (int32_t z = -extent; z <= extent; ++z)
+			{
+				table.offsets[starts[row_length_sq + z * z]++] = ChunkOffset{ x, y, z };
+			}
+		}
+	}
+	return table;
+}
+
+// One shape's table, see get_shells
+struct Shells
+{
+	std::span<const ChunkOffset> offsets{};
+	std::span<const ShellRange> ranges{};
+	int32_t vertical_scale = 1;
+
+	// End of the offsets within p_radius, p_radius is clamped to MIN_RADIUS and MAX_RADIUS
+	uint32_t get_end(int32_t p_radius) const;
+	bool contains(const godot::Vector3i& p_offset, int32_t p_radius) const;
+	// How many shells a step of p_step crosses at most, loaded shells stay loaded that much closer in
+	uint32_t get_step_shells(const godot::Vector3i& p_step) const;
+};
+
+const Shells& get_shells(Shape p_shape);
+} //namespace chunk_shells
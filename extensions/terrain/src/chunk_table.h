@@ -0,0 +1,280 @@
+#pragma once
+
+#include "epoch_manager.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Chunk positions packed into one 64 bit key, 21 bits per axis so chunks up to a million from the origin fit
+namespace chunk_key
+{
+constexpr uint64_t EMPTY = ~0ULL; // Never a packed position, the top bit is always clear
+constexpr uint64_t AXIS_MASK = (1ULL << 21) - 1;
+
+inline uint64_t pack(const godot::Vector3i& p_pos)
+{
+	return ((static_cast<uint64_t>(p_pos.x) & AXIS_MASK) << 42) | ((static_cast<uint64_t>(p_pos.y) & AXIS_MASK) << 21) | (static_cast<uint64_t>(p_pos.z) & AXIS_MASK);
+}
+
+// Spreads the packed axes over every bit, the top bits pick a shard and the low bits a slot
+inline uint64_t hash(uint64_t p_key)
+{
+	p_key ^= p_key >> 33;
+	p_key *= 0xff51afd7ed558ccdULL;
+	p_key ^= p_key >> 33;
+	p_key *= 0xc4ceb9fe1a85ec53ULL;
+	p_key ^= p_key >> 33;
+	return p_key;
+}
+} //namespace chunk_key
+
+/**
+ * @brief Open addressing hash table from packed chunk keys to pointers, with lock-free reads that never retry
+ * Linear probing over 16 byte slots, so a lookup is usually one cache line and never follows a node.
+ * A slot's key never changes once it's set, erasing only nulls the value, so a reader that finds its key reads that
+ * key's value or null and never another key's. Inserting the key again fills the same slot, keys of erased entries
+ * stay in the probe runs until the array is rebuilt.
+ * Growing, or rebuilding to drop erased slots, copies everything to a new array and publishes it. Readers still on
+ * the old one see the table as it was, the old array is freed through the EpochManager once nothing pinned can reach
+ * it, see reclaim.
+ * Writers are serialised by a mutex. ConcurrentChunkMap already serialises the writers of a shard, so CAS inserts
+ * wouldn't let any more of them through. Rebuilds are done in one go under the lock rather than spread over later
+ * operations. The map's tables hold regions of 512 chunks, so a rebuild copies a few hundred slots at most.
+ * Readers must hold a pin of p_epochs, or be on the thread that calls reclaim.
+ */
+template <typename T>
+class ChunkTable
+{
+public:
+	explicit ChunkTable(EpochManager& p_epochs, uint64_t p_capacity = 256) :
+			epochs(p_epochs)
+	{
+		uint64_t capacity = MIN_CAPACITY;
+		while (capacity < p_capacity)
+		{
+			capacity <<= 1;
+		}
+		current.store(new SlotArray(capacity), std::memory_order_release);
+	}
+
+	~ChunkTable()
+	{
+		for (const RetiredArray& retired_array : retired)
+		{
+			delete retired_array.array;
+		}
+		delete current.load(std::memory_order_relaxed);
+	}
+
+	ChunkTable(const ChunkTable&) = delete;
+	ChunkTable& operator=(const ChunkTable&) = delete;
+
+	T* find(uint64_t p_key, uint64_t p_hash) const
+	{
+		const SlotArray* array = current.load(std::memory_order_acquire);
+		for (uint64_t i = p_hash & array->mask;; i = (i + 1) & array->mask)
+		{
+			const uint64_t key = array->slots[i].key.load(std::memory_order_acquire);
+			if (key == p_key)
+			{
+				return array->slots[i].value.load(std::memory_order_acquire);
+			}
+			if (key == chunk_key::EMPTY)
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	// Returns the value already there without inserting, or p_value once it's inserted
+	T* insert(uint64_t p_key, uint64_t p_hash, T* p_value)
+	{
+		std::lock_guard lock(write_mutex);
+		SlotArray* array = current.load(std::memory_order_relaxed);
+		uint64_t i = p_hash & array->mask;
+		for (;; i = (i + 1) & array->mask)
+		{
+			const uint64_t key = array->slots[i].key.load(std::memory_order_relaxed);
+			if (key == p_key)
+			{
+				if (T* value = array->slots[i].value.load(std::memory_order_relaxed))
+				{
+					return value;
+				}
+				// Erased, the slot is still its
+				array->slots[i].value.store(p_value, std::memory_order_release);
+				++count;
+				--erased_count;
+				return p_value;
+			}
+			if (key == chunk_key::EMPTY)
+			{
+				break;
+			}
+		}
+
+		if ((count + erased_count + 1) * MAX_LOAD_DIVISOR > array->capacity())
+		{
+			rebuild();
+			array = current.load(std::memory_order_relaxed);
+			i = p_hash & array->mask;
+			while (array->slots[i].key.load(std::memory_order_relaxed) != chunk_key::EMPTY)
+			{
+				i = (i + 1) & array->mask;
+			}
+		}
+
+		// The value goes first, a reader that sees the key sees the value
+		array->slots[i].value.store(p_value, std::memory_order_relaxed);
+		array->slots[i].key.store(p_key, std::memory_order_release);
+		++count;
+		return p_value;
+	}
+
+	// Returns the removed value, or null if there was none
+	T* erase(uint64_t p_key, uint64_t p_hash)
+	{
+		std::lock_guard lock(write_mutex);
+		SlotArray* array = current.load(std::memory_order_relaxed);
+		for (uint64_t i = p_hash & array->mask;; i = (i + 1) & array->mask)
+		{
+			Slot& slot = array->slots[i];
+			const uint64_t key = slot.key.load(std::memory_order_relaxed);
+			if (key == chunk_key::EMPTY)
+			{
+				return nullptr;
+			}
+			if (key == p_key)
+			{
+				// The key stays in the probe run until a rebuild
+				T* value = slot.value.load(std::memory_order_relaxed);
+				if (value)
+				{
+					slot.value.store(nullptr, std::memory_order_release);
+					--count;
+					++erased_count;
+				}
+				return value;
+			}
+		}
+	}
+
+	// Empties the table, p_on_value gets every value that was in it
+	template <typename F>
+	void clear(F&& p_on_value)
+	{
+		std::lock_guard lock(write_mutex);
+		SlotArray* array = current.load(std::memory_order_relaxed);
+		for (uint64_t i = 0; i < array->capacity(); ++i)
+		{
+			if (T* value = array->slots[i].value.load(std::memory_order_relaxed))
+			{
+				p_on_value(value);
+			}
+		}
+		// Emptying the slots in place would let them be reused under readers still probing them
+		publish(new SlotArray(array->capacity()));
+		count = 0;
+		erased_count = 0;
+	}
+
+	// Frees the arrays grown out of that nothing pinned can reach anymore. Call after advancing the epochs
+	void reclaim()
+	{
+		std::lock_guard lock(write_mutex);
+		auto safe_end = std::ranges::find_if(retired, [this](const RetiredArray& p_retired)
+				{ return !epochs.is_safe(p_retired.epoch); });
+		for (auto it = retired.begin(); it != safe_end; ++it)
+		{
+			delete it->array;
+		}
+		retired.erase(retired.begin(), safe_end);
+	}
+
+	uint64_t size() const
+	{
+		std::lock_guard lock(write_mutex);
+		return count;
+	}
+
+private:
+	static constexpr uint64_t MIN_CAPACITY = 16;
+	// Rebuilt past half full, counting erased slots, probe runs stay short
+	static constexpr uint64_t MAX_LOAD_DIVISOR = 2;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> key{ chunk_key::EMPTY };
+		std::atomic<T*> value{ nullptr };
+	};
+
+	struct SlotArray
+	{
+		explicit SlotArray(uint64_t p_capacity) :
+				mask(p_capacity - 1), slots(std::make_unique<Slot[]>(p_capacity)) {}
+
+		uint64_t capacity() const { return mask + 1; }
+
+		uint64_t mask = 0;
+		std::unique_ptr<Slot[]> slots;
+	};
+
+	struct RetiredArray
+	{
+		uint64_t epoch = 0;
+		SlotArray* array = nullptr;
+	};
+
+	// Copies the entries to a new array, doubled unless dropping the erased slots leaves it at most a quarter full.
+	// Either way at least a quarter of the new array's slots go by before the next rebuild
+	void rebuild()
+	{
+		const SlotArray& old_array = *current.load(std::memory_order_relaxed);
+		uint64_t capacity = old_array.capacity();
+		while ((count + 1) * MAX_LOAD_DIVISOR * 2 > capacity)
+		{
+			capacity <<= 1;
+		}
+
+		SlotArray* new_array = new SlotArray(capacity);
+		for (uint64_t i = 0; i < old_array.capacity(); ++i)
+		{
+			T* value = old_array.slots[i].value.load(std::memory_order_relaxed);
+			if (!value)
+			{
+				continue; // Empty or erased
+			}
+
+			const uint64_t key = old_array.slots[i].key.load(std::memory_order_relaxed);
+			uint64_t j = chunk_key::hash(key) & new_array->mask;
+			while (new_array->slots[j].key.load(std::memory_order_relaxed) != chunk_key::EMPTY)
+			{
+				j = (j + 1) & new_array->mask;
+			}
+			new_array->slots[j].key.store(key, std::memory_order_relaxed);
+			new_array->slots[j].value.store(value, std::memory_order_relaxed);
+		}
+		publish(new_array);
+		erased_count = 0;
+	}
+
+	// Swaps in p_array, the old one is retired with the epoch it stopped being reachable in
+	void publish(SlotArray* p_array)
+	{
+		SlotArray* old_array = current.exchange(p_array, std::memory_order_acq_rel);
+		retired.push_back({ epochs.get_epoch(), old_array });
+	}
+
+	EpochManager& epochs;
+	std::atomic<SlotArray*> current{ nullptr };
+	std::vector<RetiredArray> retired{}; // In the order they were retired, so by epoch
+	uint64_t count = 0;
+	uint64_t erased_count = 0;
+	mutable std::mutex write_mutex{};
+};
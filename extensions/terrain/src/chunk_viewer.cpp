@@ -1,90 +1,152 @@
 #include "chunk_viewer.h"
 
-#include "chunk_lut.gen.h"
 #include "terrain_constants.h"
 
+#include <godot_cpp/classes/camera3d.hpp>
+#include <godot_cpp/classes/viewport.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/property_info.hpp>
+#include <godot_cpp/variant/plane.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
 #include <godot_cpp/variant/vector3i.hpp>
 
+#include <cmath>
 #include <cstdint>
-#include <vector>
+#include <mutex>
 
 using namespace godot;
+using namespace terrain_constants;
+
+// Half the diagonal of a chunk, a chunk is outside the frustum when its centre is this far behind a plane
+constexpr float CHUNK_BOUNDING_RADIUS = CHUNK_SIZE * 0.8660254f;
+// Time constants of the velocity and acceleration smoothing, the acceleration is noisier so it's smoothed more
+constexpr double VELOCITY_SMOOTHING_SECONDS = 0.2;
+constexpr double ACCELERATION_SMOOTHING_SECONDS = 0.5;
+// Moving further than this in a frame is a teleport, not motion to predict from
+constexpr float TELEPORT_DISTANCE = CHUNK_SIZE * 4.0f;
 
 void ChunkViewer::_bind_methods()
 {
 	ClassDB::bind_method(D_METHOD("get_current_chunk_pos"), &ChunkViewer::get_current_chunk_pos);
-}
 
-std::vector<Vector3i> ChunkViewer::get_chunk_positions(int64_t max_count)
-{
-	std::shared_lock lock(mutex); // Read lock
+	ClassDB::bind_method(D_METHOD("get_load_radius"), &ChunkViewer::get_load_radius);
+	ClassDB::bind_method(D_METHOD("set_load_radius", "load_radius"), &ChunkViewer::set_load_radius);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "load_radius", PROPERTY_HINT_RANGE, "3,32,1,suffix:chunks"), "set_load_radius", "get_load_radius");
+
+	ClassDB::bind_method(D_METHOD("get_load_shape"), &ChunkViewer::get_load_shape);
+	ClassDB::bind_method(D_METHOD("set_load_shape", "load_shape"), &ChunkViewer::set_load_shape);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "load_shape", PROPERTY_HINT_ENUM, "Sphere,Half Height,Quarter Height"), "set_load_shape", "get_load_shape");
 
-	ShellRange range = CHUNK_SHELL_RANGES[current_shell];
+	ClassDB::bind_method(D_METHOD("get_near_radius"), &ChunkViewer::get_near_radius);
+	ClassDB::bind_method(D_METHOD("set_near_radius", "near_radius"), &ChunkViewer::set_near_radius);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "near_radius", PROPERTY_HINT_RANGE, "0,16,0.5,or_greater,suffix:chunks"), "set_near_radius", "get_near_radius");
 
-	std::vector<Vector3i> results{};
-	results.reserve(max_count);
+	ClassDB::bind_method(D_METHOD("get_behind_camera_penalty"), &ChunkViewer::get_behind_camera_penalty);
+	ClassDB::bind_method(D_METHOD("set_behind_camera_penalty", "behind_camera_penalty"), &ChunkViewer::set_behind_camera_penalty);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "behind_camera_penalty", PROPERTY_HINT_RANGE, "1,16,0.1,or_greater"), "set_behind_camera_penalty", "get_behind_camera_penalty");
 
-	int64_t count = 0;
-	while (results.size() < max_count)
+	ClassDB::bind_method(D_METHOD("get_prefetch_seconds"), &ChunkViewer::get_prefetch_seconds);
+	ClassDB::bind_method(D_METHOD("set_prefetch_seconds", "prefetch_seconds"), &ChunkViewer::set_prefetch_seconds);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "prefetch_seconds", PROPERTY_HINT_RANGE, "0,10,0.1,or_greater,suffix:s"), "set_prefetch_seconds", "get_prefetch_seconds");
+}
+
+float ChunkViewer::View::get_chunk_weight(const Vector3i& p_chunk_pos) const
+{
+	const float distance = Vector3(p_chunk_pos - chunk_pos).length();
+	if (!has_camera || distance <= near_radius)
 	{
-		if (range.start + count >= range.end)
-		{
-			if (current_shell >= CHUNK_SHELL_RANGE_COUNT - 1)
-			{
-				break; // No more shells to process
-			}
+		return distance;
+	}
 
-			current_shell++;
-			count = 0;
-			range = CHUNK_SHELL_RANGES[current_shell];
-		}
-		Vector3i position = last_chunk_pos + CHUNK_LUT[range.start + count];
-		if (!chunk_map->has_chunk(position))
+	const Vector3 centre = (Vector3(p_chunk_pos) + Vector3(0.5f, 0.5f, 0.5f)) * CHUNK_SIZE;
+	bool is_in_frustum = true;
+	for (const Plane& plane : frustum)
+	{
+		// The planes face outwards
+		if (plane.distance_to(centre) > CHUNK_BOUNDING_RADIUS)
 		{
-			results.push_back(position);
+			is_in_frustum = false;
+			break;
 		}
-		count++;
+	}
+	if (is_in_frustum)
+	{
+		return distance;
 	}
 
-	return results; // Target index should equal the count
+	// 0 straight ahead, 1 directly behind
+	const float behind = 0.5f - 0.5f * camera_forward.dot((centre - camera_position).normalized());
+	return distance * (1.0f + (behind_camera_penalty - 1.0f) * behind);
 }
 
-void ChunkViewer::reset()
+Vector3i ChunkViewer::get_current_chunk_pos() const
 {
-	mutex.lock();
-	reset_unblocking();
-	mutex.unlock();
+	return Vector3i((get_global_position() / (float)terrain_constants::CHUNK_SIZE).floor());
 }
 
-Vector3i ChunkViewer::get_current_chunk_pos() const
+ChunkViewer::View ChunkViewer::get_view() const
 {
-	return Vector3i((get_global_position() / (float)terrain_constants::CHUNK_SIZE).floor());
+	std::lock_guard lock(view_mutex);
+	return view;
 }
 
 void ChunkViewer::_process(double delta)
 {
-	update_view();
+	update_motion(delta);
+	update_camera();
 }
 
-void ChunkViewer::update_view()
+void ChunkViewer::update_motion(double p_delta)
 {
-	godot::Vector3i current_pos = get_current_chunk_pos();
-	// Only update if we've moved to a different chunk.
-	if (current_pos == last_chunk_pos)
+	const Vector3 position = get_global_position();
+	if (!has_last_position || p_delta <= 0.0 || position.distance_to(last_position) > TELEPORT_DISTANCE)
 	{
+		velocity = Vector3();
+		acceleration = Vector3();
+		last_position = position;
+		has_last_position = true;
 		return;
 	}
-	if (mutex.try_lock())
-	{
-		reset_unblocking();
-		mutex.unlock();
-	}
+
+	const Vector3 frame_velocity = (position - last_position) / p_delta;
+	const Vector3 previous_velocity = velocity;
+	velocity += (frame_velocity - velocity) * (1.0 - std::exp(-p_delta / VELOCITY_SMOOTHING_SECONDS));
+
+	const Vector3 frame_acceleration = (velocity - previous_velocity) / p_delta;
+	acceleration += (frame_acceleration - acceleration) * (1.0 - std::exp(-p_delta / ACCELERATION_SMOOTHING_SECONDS));
+
+	last_position = position;
 }
 
-void ChunkViewer::reset_unblocking()
+void ChunkViewer::update_camera()
 {
-	current_shell = 0;
-	current_index = 0;
-	last_chunk_pos = get_current_chunk_pos();
+	View new_view{};
+	new_view.chunk_pos = get_current_chunk_pos();
+	new_view.near_radius = near_radius;
+	new_view.behind_camera_penalty = behind_camera_penalty;
+	new_view.position = last_position;
+	new_view.velocity = velocity;
+	new_view.acceleration = acceleration;
+	new_view.prefetch_seconds = prefetch_seconds;
+
+	Viewport* viewport = get_viewport();
+	Camera3D* camera = viewport ? viewport->get_camera_3d() : nullptr;
+	if (camera)
+	{
+		TypedArray<Plane> planes = camera->get_frustum();
+		if (planes.size() == static_cast<int64_t>(new_view.frustum.size()))
+		{
+			for (int64_t i = 0; i < planes.size(); ++i)
+			{
+				new_view.frustum[i] = planes[i];
+			}
+			new_view.camera_position = camera->get_global_position();
+			new_view.camera_forward = -camera->get_global_basis().get_column(2).normalized();
+			new_view.has_camera = true;
+		}
+	}
+
+	std::lock_guard lock(view_mutex);
+	view = new_view;
 }
@@ -1,14 +1,16 @@
 #pragma once
 
+#include "chunk_shells.h"
+
 #include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/classes/wrapped.hpp>
+#include <godot_cpp/variant/plane.hpp>
+#include <godot_cpp/variant/vector3.hpp>
 #include <godot_cpp/variant/vector3i.hpp>
 
-#include <concurrent_chunk_map.h>
+#include <array>
 #include <cstdint>
-#include <vector>
-#include <memory>
-#include <shared_mutex>
+#include <mutex>
 
 using namespace godot;
 
@@ -17,27 +19,71 @@ class ChunkViewer : public Node3D
 	GDCLASS(ChunkViewer, Node3D)
 
 public:
-	std::shared_ptr<ConcurrentChunkMap> chunk_map;
+	// Snapshot of the camera taken each frame, used to load what's in view first
+	struct View
+	{
+		Vector3i chunk_pos{};
+		Vector3 camera_position{};
+		Vector3 camera_forward{};
+		std::array<Plane, 6> frustum{};
+		bool has_camera = false;
+		float near_radius = 0.0f;
+		float behind_camera_penalty = 1.0f;
 
-	std::vector<Vector3i> get_chunk_positions(int64_t count);
+		// Smoothed motion of the viewer in world units, used to prefetch along its path
+		Vector3 position{};
+		Vector3 velocity{};
+		Vector3 acceleration{};
+		float prefetch_seconds = 0.0f;
 
-	void reset();
+		// Distance in chunks, scaled up for chunks outside the frustum the further behind the camera they are. Lower loads first
+		float get_chunk_weight(const Vector3i& p_chunk_pos) const;
+	};
 
 	Vector3i get_current_chunk_pos() const;
+	// Thread safe
+	View get_view() const;
 
 	void _process(double delta) override; // _process must be public
 
+	// Chunks are loaded and kept within this many chunks, clamped to chunk_shells::MIN_RADIUS and MAX_RADIUS. See ChunkInterest
+	int64_t load_radius = 32;
+	// The flattened shapes load less above and below, for height field worlds. See chunk_shells.h
+	chunk_shells::Shape load_shape = chunk_shells::Shape::Sphere;
+	// Chunks this close are never penalised, so collision around the viewer always loads first
+	float near_radius = 2.0f;
+	// Weight multiplier for chunks directly behind the camera, chunks beside it get half of the penalty
+	float behind_camera_penalty = 3.0f;
+	// Chunks are generated along the predicted path this far ahead, as many as the pipeline gets through in that time. 0 disables it
+	float prefetch_seconds = 3.0f;
+
 protected:
 	static void _bind_methods();
 
-private:
-	void update_view();
-	void reset_unblocking();
+	int64_t get_load_radius() const { return load_radius; }
+	void set_load_radius(int64_t p_load_radius) { load_radius = p_load_radius; }
+
+	int64_t get_load_shape() const { return static_cast<int64_t>(load_shape); }
+	void set_load_shape(int64_t p_load_shape) { load_shape = static_cast<chunk_shells::Shape>(p_load_shape); }
 
-	int current_shell = 0;
-	int current_index = 0;
+	float get_near_radius() const { return near_radius; }
+	void set_near_radius(float p_near_radius) { near_radius = p_near_radius; }
+
+	float get_behind_camera_penalty() const { return behind_camera_penalty; }
+	void set_behind_camera_penalty(float p_behind_camera_penalty) { behind_camera_penalty = p_behind_camera_penalty; }
+
+	float get_prefetch_seconds() const { return prefetch_seconds; }
+	void set_prefetch_seconds(float p_prefetch_seconds) { prefetch_seconds = p_prefetch_seconds; }
+
+private:
+	void update_motion(double p_delta);
+	void update_camera();
 
-	Vector3i last_chunk_pos = Vector3i(0, 0, 0);
+	Vector3 velocity{};
+	Vector3 acceleration{};
+	Vector3 last_position{};
+	bool has_last_position = false;
 
-	std::shared_mutex mutex{};
+	View view{};
+	mutable std::mutex view_mutex{};
 };
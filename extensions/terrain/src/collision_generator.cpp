@@ -1,21 +1,21 @@
 #include "collision_generator.h"
 
+#include "concurrent_chunk_map.h"
 #include "mesh_generator.h"
+#include "mesh_simplifier.h"
 #include "terrain_constants.h"
 
 #include <godot_cpp/classes/array_mesh.hpp>
 #include <godot_cpp/classes/concave_polygon_shape3d.hpp>
-#include <godot_cpp/classes/mesh.hpp>
 #include <godot_cpp/classes/ref.hpp>
 #include <godot_cpp/classes/triangle_mesh.hpp>
-#include <godot_cpp/variant/array.hpp>
-#include <godot_cpp/variant/packed_int32_array.hpp>
 #include <godot_cpp/variant/packed_vector3_array.hpp>
 #include <godot_cpp/variant/vector3.hpp>
 
 #include <array>
 #include <cmath>
 #include <cstdint>
+#include <vector>
 
 using namespace godot;
 using namespace terrain_constants;
@@ -25,15 +25,43 @@ CollisionData CollisionGenerator::process_task(MeshData p_mesh_data)
 	CollisionData result{};
 
 	result.chunk_pos = p_mesh_data.chunk_pos;
+	result.chunk_version = p_mesh_data.chunk_version;
 
-	result.collision_shape.instantiate();
+	if (chunk_map && !chunk_map->is_current(p_mesh_data.chunk_pos, p_mesh_data.chunk_version))
+	{
+		return result; // No shape, it's dropped when it's taken
+	}
+
+	if (collision_shape_pool)
+	{
+		result.collision_shape = collision_shape_pool->acquire();
+	}
+	else
+	{
+		result.collision_shape.instantiate();
+	}
 	result.collision_shape->set_backface_collision_enabled(false);
 
 	if (p_mesh_data.array_mesh.is_valid())
 	{
 		PackedVector3Array faces = p_mesh_data.array_mesh->generate_triangle_mesh()->get_faces();
-		Ref<ArrayMesh> array_mesh = optimise_mesh(faces);
-		result.collision_shape = array_mesh->create_trimesh_shape();
+		optimise_mesh(faces);
+
+		simplifier.simplify(vertices, indices, triangle_budget, max_error);
+
+		// Expand back into a triangle soup, which is what the physics shape wants
+		PackedVector3Array collision_faces;
+		collision_faces.resize(indices.size());
+		Vector3* collision_faces_ptr = collision_faces.ptrw();
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			collision_faces_ptr[i] = vertices[indices[i]];
+		}
+		result.collision_shape->set_faces(collision_faces);
+	}
+	else
+	{
+		result.collision_shape->set_faces(PackedVector3Array()); // A recycled shape still has its old faces
 	}
 
 	return result;
@@ -41,12 +69,12 @@ CollisionData CollisionGenerator::process_task(MeshData p_mesh_data)
 
 static thread_local std::array<int32_t, 3 * POINTS_VOLUME> edge_to_index;
 
-Ref<ArrayMesh> CollisionGenerator::optimise_mesh(const PackedVector3Array& verts)
+void CollisionGenerator::optimise_mesh(const PackedVector3Array& verts)
 {
 	edge_to_index.fill(-1);
 
-	PackedVector3Array vertices;
-	PackedInt32Array indices;
+	vertices.clear();
+	indices.clear();
 
 	const int64_t vert_count = verts.size();
 	const Vector3* verts_ptr = verts.ptr();
@@ -79,15 +107,4 @@ Ref<ArrayMesh> CollisionGenerator::optimise_mesh(const PackedVector3Array& verts
 			indices.push_back(edge_to_index[edge_id]);
 		}
 	}
-
-	Array arrays;
-	arrays.resize(Mesh::ARRAY_MAX);
-	arrays[Mesh::ARRAY_VERTEX] = vertices;
-	arrays[Mesh::ARRAY_INDEX] = indices;
-
-	Ref<ArrayMesh> mesh;
-	mesh.instantiate();
-	mesh->add_surface_from_arrays(Mesh::PRIMITIVE_TRIANGLES, arrays);
-
-	return mesh;
 }
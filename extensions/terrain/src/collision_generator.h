@@ -2,6 +2,8 @@
 
 #include "abstract_task_processer.h"
 #include "mesh_generator.h"
+#include "mesh_simplifier.h"
+#include "resource_pool.h"
 
 #include <godot_cpp/classes/array_mesh.hpp>
 #include <godot_cpp/classes/concave_polygon_shape3d.hpp>
@@ -10,13 +12,21 @@
 #include <godot_cpp/classes/wrapped.hpp>
 #include <godot_cpp/core/memory.hpp>
 #include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
 #include <godot_cpp/variant/vector3i.hpp>
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 using namespace godot;
 
+class ConcurrentChunkMap;
+
 struct CollisionData
 {
 	Vector3i chunk_pos{};
+	uint64_t chunk_version = 0; // From the MeshData it was built from, outdated collision isn't applied
 	Ref<ConcavePolygonShape3D> collision_shape;
 };
 
@@ -28,9 +38,16 @@ public:
 	CollisionGenerator() = default;
 	virtual ~CollisionGenerator() = default;
 
-	static Ref<CollisionGenerator> create()
+	// p_triangle_budget <= 0 and p_max_error <= 0 disable the budget and error bound, see MeshSimplifier
+	// Shapes are taken from p_collision_shape_pool when one is given.
+	// With p_chunk_map, meshes of chunks that were edited or unloaded since are skipped, see ConcurrentChunkMap::is_current
+	static Ref<CollisionGenerator> create(int64_t p_triangle_budget = 0, float p_max_error = 0.0f, std::shared_ptr<ResourcePool<ConcavePolygonShape3D>> p_collision_shape_pool = nullptr, std::shared_ptr<const ConcurrentChunkMap> p_chunk_map = nullptr)
 	{
 		Ref<CollisionGenerator> chunk_generator = memnew((CollisionGenerator));
+		chunk_generator->triangle_budget = p_triangle_budget;
+		chunk_generator->max_error = p_max_error;
+		chunk_generator->collision_shape_pool = std::move(p_collision_shape_pool);
+		chunk_generator->chunk_map = std::move(p_chunk_map);
 		return chunk_generator;
 	}
 
@@ -40,5 +57,15 @@ protected:
 	static void _bind_methods() {}
 
 private:
-	Ref<ArrayMesh> optimise_mesh(const PackedVector3Array& verts);
+	// Welds the triangle soup into vertices and indices so it can be simplified
+	void optimise_mesh(const PackedVector3Array& verts);
+
+	int64_t triangle_budget = 0;
+	float max_error = 0.0f;
+	std::shared_ptr<ResourcePool<ConcavePolygonShape3D>> collision_shape_pool;
+	std::shared_ptr<const ConcurrentChunkMap> chunk_map;
+
+	MeshSimplifier simplifier;
+	std::vector<Vector3> vertices;
+	std::vector<uint32_t> indices;
 };
@@ -0,0 +1,138 @@
+#include "collision_interest.h"
+
+#include "terrain_constants.h"
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/core/object.hpp>
+#include <godot_cpp/variant/aabb.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace godot;
+using namespace terrain_constants;
+
+// A body that moved further than this (in chunks) since the last update teleported, so don't sweep the gap
+constexpr int32_t MAX_SWEEP_CHUNKS = 4;
+
+void CollisionInterest::add_body(Node3D* p_body, float p_radius)
+{
+	if (!p_body)
+	{
+		return;
+	}
+
+	const uint64_t object_id = p_body->get_instance_id();
+	for (Body& body : bodies)
+	{
+		if (body.object_id == object_id)
+		{
+			body.radius = p_radius;
+			return;
+		}
+	}
+
+	Body body{};
+	body.object_id = object_id;
+	body.radius = p_radius;
+	bodies.push_back(body);
+}
+
+void CollisionInterest::remove_body(Node3D* p_body)
+{
+	if (!p_body)
+	{
+		return;
+	}
+
+	const uint64_t object_id = p_body->get_instance_id();
+	std::erase_if(bodies, [object_id](const Body& body)
+			{ return body.object_id == object_id; });
+}
+
+void CollisionInterest::clear()
+{
+	bodies.clear();
+	wanted.clear();
+	next_wanted.clear();
+}
+
+void CollisionInterest::update(std::vector<Vector3i>& r_entered, std::vector<Vector3i>& r_exited)
+{
+	next_wanted.clear();
+
+	for (auto it = bodies.begin(); it != bodies.end();)
+	{
+		Node3D* node = Object::cast_to<Node3D>(ObjectDB::get_instance(it->object_id));
+		if (!node)
+		{
+			// The body was freed without being removed
+			it = bodies.erase(it);
+			continue;
+		}
+
+		if (!node->is_inside_tree())
+		{
+			it->has_last_position = false;
+			++it;
+			continue;
+		}
+
+		const Vector3 position = node->get_global_position();
+		const Vector3 previous = it->has_last_position ? it->last_position : position;
+
+		AABB bounds(position, Vector3());
+		bounds.expand_to(previous);
+		bounds.expand_to(position + (position - previous)); // One step ahead, so fast bodies have collision before they arrive
+		bounds.grow_by(it->radius);
+
+		Vector3i min_chunk = Vector3i((bounds.position / (float)CHUNK_SIZE).floor());
+		Vector3i max_chunk = Vector3i((bounds.get_end() / (float)CHUNK_SIZE).floor());
+
+		Vector3i extent = max_chunk - min_chunk;
+		if (extent.x > MAX_SWEEP_CHUNKS || extent.y > MAX_SWEEP_CHUNKS || extent.z > MAX_SWEEP_CHUNKS)
+		{
+			AABB current_bounds(position, Vector3());
+			current_bounds.grow_by(it->radius);
+			min_chunk = Vector3i((current_bounds.position / (float)CHUNK_SIZE).floor());
+			max_chunk = Vector3i((current_bounds.get_end() / (float)CHUNK_SIZE).floor());
+		}
+
+		for (int32_t z = min_chunk.z; z <= max_chunk.z; ++z)
+		{
+			for (int32_t y = min_chunk.y; y <= max_chunk.y; ++y)
+			{
+				for (int32_t x = min_chunk.x; x <= max_chunk.x; ++x)
+				{
+					next_wanted.insert(Vector3i(x, y, z));
+				}
+			}
+		}
+
+		it->last_position = position;
+		it->has_last_position = true;
+		++it;
+	}
+
+	for (const Vector3i& chunk_pos : next_wanted)
+	{
+		if (!wanted.contains(chunk_pos))
+		{
+			r_entered.push_back(chunk_pos);
+		}
+	}
+
+	for (const Vector3i& chunk_pos : wanted)
+	{
+		if (!next_wanted.contains(chunk_pos))
+		{
+			r_exited.push_back(chunk_pos);
+		}
+	}
+
+	std::swap(wanted, next_wanted);
+}
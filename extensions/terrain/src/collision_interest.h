@@ -0,0 +1,50 @@
+#pragma once
+
+#include "concurrent_chunk_map.h"
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+using namespace godot;
+
+/**
+ * @brief Tracks which chunks need collision
+ * Any number of bodies can be registered. Each update the chunks touched by a body's swept bounds
+ * (last position, current position and one step ahead, grown by its radius) are wanted.
+ * Only used from the main thread.
+ */
+class CollisionInterest
+{
+public:
+	void add_body(Node3D* p_body, float p_radius);
+	void remove_body(Node3D* p_body);
+	void clear();
+
+	int64_t get_body_count() const { return bodies.size(); }
+
+	// Recomputes the wanted chunks from the current body positions
+	// r_entered gets the chunks that became wanted, r_exited gets the chunks that no body wants anymore
+	void update(std::vector<Vector3i>& r_entered, std::vector<Vector3i>& r_exited);
+
+	bool is_wanted(const Vector3i& p_chunk_pos) const { return wanted.contains(p_chunk_pos); }
+
+private:
+	struct Body
+	{
+		uint64_t object_id = 0;
+		float radius = 0.0f;
+		Vector3 last_position{};
+		bool has_last_position = false;
+	};
+
+	std::vector<Body> bodies;
+
+	using ChunkSet = std::unordered_set<Vector3i, Vector3iHasher>;
+	ChunkSet wanted{};
+	ChunkSet next_wanted{}; // Scratch set, swapped with wanted each update
+};
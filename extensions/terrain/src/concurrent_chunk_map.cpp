@@ -0,0 +1,558 @@
+#include "concurrent_chunk_map.h"
+
+#include "chunk_data.h"
+#include "chunk_table.h"
+#include "safe_pool.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace godot;
+
+ConcurrentChunkMap::~ConcurrentChunkMap()
+{
+	unload_all();
+	map_shards.clear();
+	pool_shards.clear();
+}
+
+void ConcurrentChunkMap::mark_dirty(ChunkData* p_chunk)
+{
+	std::lock_guard lock(dirty_mutex);
+	if (!p_chunk->is_dirty)
+	{
+		p_chunk->is_dirty = true;
+		dirty_positions.push_back(p_chunk->position);
+	}
+}
+
+std::vector<Vector3i> ConcurrentChunkMap::consume_dirty_list()
+{
+	std::lock_guard lock(dirty_mutex);
+	std::vector<Vector3i> result{};
+	result.swap(dirty_positions);
+	std::erase_if(result, [this](const Vector3i& p_chunk_pos)
+			{
+				ChunkData* chunk = get_chunk(p_chunk_pos);
+				if (!chunk || !chunk->is_dirty)
+				{
+					return true;
+				}
+				chunk->is_dirty = false;
+				return false;
+			});
+	return result;
+}
+
+ChunkData* ConcurrentChunkMap::get_chunk(Vector3i pos) const
+{
+	return find(locate(pos));
+}
+
+const ChunkData* ConcurrentChunkMap::get_generated_chunk(const Vector3i& p_pos) const
+{
+	const ChunkData* chunk = get_chunk(p_pos);
+	return chunk && chunk->is_generated.load(std::memory_order_acquire) ? chunk : nullptr;
+}
+
+bool ConcurrentChunkMap::is_current(const Vector3i& p_pos, uint64_t p_version) const
+{
+	const EpochManager::Pin pin = epochs.pin();
+	return get_current(p_pos, p_version) != nullptr;
+}
+
+ChunkData* ConcurrentChunkMap::get_current(const Vector3i& p_pos, uint64_t p_version) const
+{
+	ChunkData* chunk = get_chunk(p_pos);
+	return chunk && chunk->version == p_version ? chunk : nullptr;
+}
+
+void ConcurrentChunkMap::get_neighbourhood(const Vector3i& p_pos, Neighbourhood& r_neighbourhood) const
+{
+	// The 27 chunks span at most 2 regions along each axis
+	std::array<std::pair<uint64_t, const Region*>, 8> regions{};
+	uint32_t region_count = 0;
+
+	uint32_t index = 0;
+	for (int32_t z = -1; z <= 1; ++z)
+	{
+		for (int32_t y = -1; y <= 1; ++y)
+		{
+			for (int32_t x = -1; x <= 1; ++x)
+			{
+				const Location location = locate(p_pos + Vector3i(x, y, z));
+
+				const Region* region = nullptr;
+				uint32_t i = 0;
+				while (i < region_count && regions[i].first != location.region_key)
+				{
+					++i;
+				}
+				if (i < region_count)
+				{
+					region = regions[i].second;
+				}
+				else
+				{
+					region = map_shards[get_shard(location.hash)].regions.find(location.region_key, location.hash);
+					regions[region_count++] = { location.region_key, region };
+				}
+
+				ChunkData* chunk = region ? region->chunks[location.slot].load(std::memory_order_acquire) : nullptr;
+				if (region && region->key.load(std::memory_order_acquire) != location.region_key)
+				{
+					chunk = find(location); // The region was emptied and reused while it was read
+				}
+				r_neighbourhood[index++] = chunk;
+			}
+		}
+	}
+}
+
+ChunkData* ConcurrentChunkMap::get_or_create(Vector3i pos)
+{
+	const Location location = locate(pos);
+	if (ChunkData* existing_chunk = find(location))
+	{
+		return existing_chunk;
+	}
+
+	// Take chunk from the pool and put it in the loaded chunks
+	const uint64_t shard_idx = get_shard(location.hash);
+	MapShard& shard = map_shards[shard_idx];
+	SafePool<ChunkData>& pool = *pool_shards[shard_idx].pool;
+	ChunkData* new_chunk = pool.acquire().release();
+	new_chunk->position = pos;
+	new_chunk->version = take_version();
+	new_chunk->is_dirty = false;
+	new_chunk->is_generated.store(false, std::memory_order_relaxed);
+
+	ChunkData* existing_chunk = nullptr;
+	{
+		std::lock_guard lock(shard.write_mutex);
+		Region* region = get_or_add_region_locked(shard, location);
+		existing_chunk = region->chunks[location.slot].load(std::memory_order_relaxed);
+		if (!existing_chunk)
+		{
+			region->chunks[location.slot].store(new_chunk, std::memory_order_release);
+			++region->count;
+			shard.chunk_count.fetch_add(1, std::memory_order_relaxed);
+			return new_chunk;
+		}
+	}
+
+	pool.release(new_chunk); // Another thread created it first
+	return existing_chunk;
+}
+
+void ConcurrentChunkMap::get_or_create_many(const std::vector<Vector3i>& p_positions, std::vector<ChunkData*>& r_chunks, std::vector<uint8_t>& r_created)
+{
+	std::vector<Location> locations;
+	std::vector<uint32_t> order;
+	std::array<uint32_t, SHARD_COUNT + 1> shard_starts;
+	bucket_by_shard(p_positions, locations, order, shard_starts);
+	r_chunks.resize(p_positions.size());
+	r_created.assign(p_positions.size(), false);
+
+	std::vector<uint32_t> missing;
+	std::vector<ChunkData*> new_chunks;
+	std::vector<ChunkData*> unused;
+	for (uint64_t shard_idx = 0; shard_idx < SHARD_COUNT; ++shard_idx)
+	{
+		// Lookups don't lock, only the missing ones go through the pool and the write lock
+		missing.clear();
+		for (uint32_t i = shard_starts[shard_idx]; i < shard_starts[shard_idx + 1]; ++i)
+		{
+			r_chunks[order[i]] = find(locations[i]);
+			if (!r_chunks[order[i]])
+			{
+				missing.push_back(i);
+			}
+		}
+		if (missing.empty())
+		{
+			continue;
+		}
+
+		MapShard& shard = map_shards[shard_idx];
+		SafePool<ChunkData>& pool = *pool_shards[shard_idx].pool;
+		new_chunks.clear();
+		pool.acquire_many(missing.size(), new_chunks);
+
+		unused.clear();
+		{
+			std::lock_guard lock(shard.write_mutex);
+			for (uint64_t j = 0; j < missing.size(); ++j)
+			{
+				const Location& location = locations[missing[j]];
+				const uint32_t position_index = order[missing[j]];
+				ChunkData* new_chunk = new_chunks[j];
+
+				Region* region = get_or_add_region_locked(shard, location);
+				if (ChunkData* existing_chunk = region->chunks[location.slot].load(std::memory_order_relaxed))
+				{
+					// Another thread created it first, or it's listed twice
+					r_chunks[position_index] = existing_chunk;
+					unused.push_back(new_chunk);
+					continue;
+				}
+
+				new_chunk->position = p_positions[position_index];
+				new_chunk->version = take_version();
+				new_chunk->is_dirty = false;
+				new_chunk->is_generated.store(false, std::memory_order_relaxed);
+				region->chunks[location.slot].store(new_chunk, std::memory_order_release);
+				++region->count;
+				shard.chunk_count.fetch_add(1, std::memory_order_relaxed);
+				r_chunks[position_index] = new_chunk;
+				r_created[position_index] = true;
+			}
+		}
+		if (!unused.empty())
+		{
+			pool.release_many(unused);
+		}
+	}
+}
+
+void ConcurrentChunkMap::contains_many(const std::vector<Vector3i>& p_positions, std::vector<uint8_t>& r_contains) const
+{
+	r_contains.resize(p_positions.size());
+	for (uint64_t i = 0; i < p_positions.size(); ++i)
+	{
+		r_contains[i] = has_chunk(p_positions[i]);
+	}
+}
+
+ChunkData* ConcurrentChunkMap::acquire_snapshot(const Vector3i& p_pos, const ChunkData* p_source)
+{
+	const uint64_t shard_idx = get_shard(locate(p_pos).hash);
+	ChunkData* snapshot = pool_shards[shard_idx].pool->acquire().release();
+	if (p_source)
+	{
+		copy_chunk_contents(*snapshot, *p_source);
+	}
+	snapshot->position = p_pos;
+	snapshot->is_dirty = false;
+	snapshot->is_generated.store(p_source && p_source->is_generated.load(std::memory_order_acquire), std::memory_order_relaxed);
+	return snapshot;
+}
+
+void ConcurrentChunkMap::publish_snapshot(ChunkData* p_snapshot, bool p_mark_dirty)
+{
+	// Written while nothing else can see it yet
+	p_snapshot->version = take_version();
+	if (p_mark_dirty)
+	{
+		mark_dirty(p_snapshot);
+	}
+
+	const Location location = locate(p_snapshot->position);
+	const uint64_t shard_idx = get_shard(location.hash);
+	MapShard& shard = map_shards[shard_idx];
+
+	ChunkData* old_chunk = nullptr;
+	{
+		std::lock_guard lock(shard.write_mutex);
+		Region* region = get_or_add_region_locked(shard, location);
+		old_chunk = region->chunks[location.slot].exchange(p_snapshot, std::memory_order_acq_rel);
+		if (!old_chunk)
+		{
+			++region->count;
+			shard.chunk_count.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	if (old_chunk)
+	{
+		retire(shard_idx, { old_chunk });
+	}
+}
+
+void ConcurrentChunkMap::discard_snapshot(ChunkData* p_snapshot)
+{
+	pool_shards[get_shard(locate(p_snapshot->position).hash)].pool->release(p_snapshot);
+}
+
+void ConcurrentChunkMap::unload_chunk(Vector3i pos)
+{
+	const Location location = locate(pos);
+	const uint64_t shard_idx = get_shard(location.hash);
+	MapShard& shard = map_shards[shard_idx];
+
+	ChunkData* chunk = nullptr;
+	{
+		std::lock_guard lock(shard.write_mutex);
+		chunk = remove_locked(shard, location);
+	}
+	if (chunk)
+	{
+		retire(shard_idx, { chunk });
+	}
+}
+
+void ConcurrentChunkMap::unload_many(const std::vector<Vector3i>& p_positions)
+{
+	std::vector<Location> locations;
+	std::vector<uint32_t> order;
+	std::array<uint32_t, SHARD_COUNT + 1> shard_starts;
+	bucket_by_shard(p_positions, locations, order, shard_starts);
+
+	std::vector<ChunkData*> removed;
+	for (uint64_t shard_idx = 0; shard_idx < SHARD_COUNT; ++shard_idx)
+	{
+		if (shard_starts[shard_idx] == shard_starts[shard_idx + 1])
+		{
+			continue;
+		}
+
+		MapShard& shard = map_shards[shard_idx];
+		removed.clear();
+		{
+			std::lock_guard lock(shard.write_mutex);
+			for (uint32_t i = shard_starts[shard_idx]; i < shard_starts[shard_idx + 1]; ++i)
+			{
+				if (ChunkData* chunk = remove_locked(shard, locations[i]))
+				{
+					removed.push_back(chunk);
+				}
+			}
+		}
+		retire(shard_idx, removed);
+	}
+}
+
+void ConcurrentChunkMap::unload_all()
+{
+	std::vector<ChunkData*> removed;
+	for (uint64_t shard_idx = 0; shard_idx < map_shards.size(); ++shard_idx)
+	{
+		MapShard& shard = map_shards[shard_idx];
+		removed.clear();
+		{
+			std::lock_guard lock(shard.write_mutex);
+			shard.regions.clear([](Region*) {});
+			for (const std::unique_ptr<Region>& region : shard.region_storage)
+			{
+				if (region->key.load(std::memory_order_relaxed) == chunk_key::EMPTY)
+				{
+					continue; // Already free
+				}
+
+				for (std::atomic<ChunkData*>& slot : region->chunks)
+				{
+					if (ChunkData* chunk = slot.exchange(nullptr, std::memory_order_acq_rel))
+					{
+						removed.push_back(chunk);
+					}
+				}
+				region->count = 0;
+				region->key.store(chunk_key::EMPTY, std::memory_order_release);
+				shard.free_regions.push_back(region.get());
+			}
+			shard.chunk_count.store(0, std::memory_order_relaxed);
+		}
+		retire(shard_idx, removed);
+	}
+}
+
+int64_t ConcurrentChunkMap::reclaim()
+{
+	epochs.try_advance();
+
+	for (MapShard& shard : map_shards)
+	{
+		shard.regions.reclaim();
+	}
+
+	int64_t reclaimed_count = 0;
+	std::vector<ChunkData*> reclaimed;
+	for (PoolShard& shard : pool_shards)
+	{
+		reclaimed.clear();
+		{
+			std::lock_guard lock(shard.retired_mutex);
+			auto safe_end = std::ranges::find_if(shard.retired, [this](const RetiredChunk& p_retired)
+					{ return !epochs.is_safe(p_retired.epoch); });
+			for (auto it = shard.retired.begin(); it != safe_end; ++it)
+			{
+				reclaimed.push_back(it->chunk);
+			}
+			shard.retired.erase(shard.retired.begin(), safe_end);
+		}
+		if (!reclaimed.empty())
+		{
+			shard.pool->release_many(reclaimed);
+			reclaimed_count += reclaimed.size();
+		}
+	}
+	return reclaimed_count;
+}
+
+int64_t ConcurrentChunkMap::get_retired_count() const
+{
+	int64_t count = 0;
+	for (const PoolShard& shard : pool_shards)
+	{
+		std::lock_guard lock(shard.retired_mutex);
+		count += shard.retired.size();
+	}
+	return count;
+}
+
+void ConcurrentChunkMap::retire(uint64_t p_shard_idx, const std::vector<ChunkData*>& p_chunks)
+{
+	if (p_chunks.empty())
+	{
+		return;
+	}
+
+	PoolShard& shard = pool_shards[p_shard_idx];
+	std::lock_guard lock(shard.retired_mutex);
+	// Read under the lock so the list stays in epoch order
+	const uint64_t epoch = epochs.get_epoch();
+	for (ChunkData* chunk : p_chunks)
+	{
+		shard.retired.push_back({ epoch, chunk });
+	}
+}
+
+int64_t ConcurrentChunkMap::get_loaded_count() const
+{
+	int64_t count = 0;
+	for (const MapShard& shard : map_shards)
+	{
+		count += shard.chunk_count.load(std::memory_order_relaxed);
+	}
+	return count;
+}
+
+int64_t ConcurrentChunkMap::get_pool_count() const
+{
+	int64_t count = 0;
+	for (const PoolShard& shard : pool_shards)
+	{
+		count += shard.pool->size();
+	}
+	return count;
+}
+
+int64_t ConcurrentChunkMap::get_pool_capacity() const
+{
+	int64_t count = 0;
+	for (const PoolShard& shard : pool_shards)
+	{
+		count += shard.pool->get_capacity();
+	}
+	return count;
+}
+
+ConcurrentChunkMap::Location ConcurrentChunkMap::locate(const Vector3i& p_pos)
+{
+	constexpr int32_t mask = REGION_SIZE - 1;
+	Location location{};
+	location.region_key = chunk_key::pack(Vector3i(p_pos.x >> REGION_BITS, p_pos.y >> REGION_BITS, p_pos.z >> REGION_BITS));
+	location.hash = chunk_key::hash(location.region_key);
+	location.slot = (p_pos.x & mask) | ((p_pos.y & mask) << REGION_BITS) | ((p_pos.z & mask) << (REGION_BITS * 2));
+	return location;
+}
+
+void ConcurrentChunkMap::bucket_by_shard(const std::vector<Vector3i>& p_positions, std::vector<Location>& r_locations, std::vector<uint32_t>& r_order, std::array<uint32_t, SHARD_COUNT + 1>& r_shard_starts)
+{
+	r_shard_starts.fill(0);
+	std::vector<Location> locations(p_positions.size());
+	for (uint64_t i = 0; i < p_positions.size(); ++i)
+	{
+		locations[i] = locate(p_positions[i]);
+		++r_shard_starts[get_shard(locations[i].hash) + 1];
+	}
+	for (uint64_t i = 1; i < r_shard_starts.size(); ++i)
+	{
+		r_shard_starts[i] += r_shard_starts[i - 1];
+	}
+
+	std::array<uint32_t, SHARD_COUNT> next{};
+	std::copy_n(r_shard_starts.begin(), SHARD_COUNT, next.begin());
+	r_locations.resize(p_positions.size());
+	r_order.resize(p_positions.size());
+	for (uint64_t i = 0; i < p_positions.size(); ++i)
+	{
+		const uint32_t index = next[get_shard(locations[i].hash)]++;
+		r_locations[index] = locations[i];
+		r_order[index] = static_cast<uint32_t>(i);
+	}
+}
+
+ChunkData* ConcurrentChunkMap::find(const Location& p_location) const
+{
+	const ChunkTable<Region>& regions = map_shards[get_shard(p_location.hash)].regions;
+	while (true)
+	{
+		const Region* region = regions.find(p_location.region_key, p_location.hash);
+		if (!region)
+		{
+			return nullptr;
+		}
+
+		ChunkData* chunk = region->chunks[p_location.slot].load(std::memory_order_acquire);
+		if (region->key.load(std::memory_order_acquire) == p_location.region_key)
+		{
+			return chunk;
+		}
+		// The region was emptied and reused while it was read, look it up again
+	}
+}
+
+ConcurrentChunkMap::Region* ConcurrentChunkMap::get_or_add_region_locked(MapShard& p_shard, const Location& p_location)
+{
+	if (Region* region = p_shard.regions.find(p_location.region_key, p_location.hash))
+	{
+		return region;
+	}
+
+	Region* region = nullptr;
+	if (p_shard.free_regions.empty())
+	{
+		p_shard.region_storage.push_back(std::make_unique<Region>());
+		region = p_shard.region_storage.back().get();
+	}
+	else
+	{
+		region = p_shard.free_regions.back();
+		p_shard.free_regions.pop_back();
+	}
+
+	region->key.store(p_location.region_key, std::memory_order_release);
+	p_shard.regions.insert(p_location.region_key, p_location.hash, region);
+	return region;
+}
+
+ChunkData* ConcurrentChunkMap::remove_locked(MapShard& p_shard, const Location& p_location)
+{
+	Region* region = p_shard.regions.find(p_location.region_key, p_location.hash);
+	if (!region)
+	{
+		return nullptr;
+	}
+
+	ChunkData* chunk = region->chunks[p_location.slot].exchange(nullptr, std::memory_order_acq_rel);
+	if (!chunk)
+	{
+		return nullptr;
+	}
+	p_shard.chunk_count.fetch_sub(1, std::memory_order_relaxed);
+
+	if (--region->count == 0)
+	{
+		p_shard.regions.erase(p_location.region_key, p_location.hash);
+		region->key.store(chunk_key::EMPTY, std::memory_order_release);
+		p_shard.free_regions.push_back(region);
+	}
+	return chunk;
+}
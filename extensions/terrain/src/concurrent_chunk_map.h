@@ -1,14 +1,18 @@
 #pragma once
 
 #include "chunk_data.h"
+#include "chunk_table.h"
+#include "epoch_manager.h"
 #include "safe_pool.h"
 
 #include <godot_cpp/variant/vector3i.hpp>
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -37,46 +41,39 @@ struct Vector3iHasher
 	}
 };
 
+/**
+ * @brief Loaded chunks by position, safe to use from any thread
+ * Chunks are stored in regions of 8x8x8 chunks, each a dense array of chunk slots, so neighbours are found by indexing
+ * into the same region rather than hashing each one. Regions are kept in ChunkTables split into shards, each shard has
+ * its own pool of ChunkData. Lookups never lock, writers only lock their shard.
+ * Empty regions leave the table and are reused, they're never freed while the map exists so a reader can't fault on one.
+ * Removed chunks are retired rather than going straight back to their pool, reclaim recycles them once nothing pinned
+ * can still reach them, and frees the arrays the region tables have grown out of. Lookups off the main thread, and
+ * anything that keeps a chunk pointer past the main thread's next reclaim, must hold a pin. Pins hold up reclaiming,
+ * so work waiting in a queue refers to chunks by ChunkTask instead.
+ */
 class ConcurrentChunkMap
 {
-private:
-	static constexpr uint64_t SHARD_COUNT = 32;
-
-	// Pool for unused chunks
-	struct PoolShard
-	{
-		std::shared_ptr<SafePool<ChunkData>> pool{ SafePool<ChunkData>::create() };
-	};
-
-	std::vector<PoolShard> pool_shards;
-
-	struct MapShard
-	{
-		std::unordered_map<Vector3i, ChunkPtr, Vector3iHasher> data;
-		mutable std::shared_mutex mutex; // TODO Replace all std::mutex with godot::Mutex for better engine stability and cross-platform support.
-	};
-
-	std::vector<MapShard> map_shards;
-
-	// Separate list of work for the Compute Thread
-	std::unordered_set<Vector3i, Vector3iHasher> dirty_positions{};
-	std::mutex dirty_mutex{};
+public:
+	static constexpr int32_t REGION_BITS = 3;
+	static constexpr int32_t REGION_SIZE = 1 << REGION_BITS;
+	static constexpr int32_t REGION_VOLUME = REGION_SIZE * REGION_SIZE * REGION_SIZE;
 
-	int64_t get_shard(const Vector3i& pos) const
-	{
-		return Vector3iHasher()(pos) & (SHARD_COUNT - 1);
-	}
+	// The chunk and its 26 neighbours, index (x + 1) + (y + 1) * 3 + (z + 1) * 9 for offsets of -1 to 1
+	using Neighbourhood = std::array<ChunkData*, 27>;
 
-public:
 	ConcurrentChunkMap() :
-			map_shards(SHARD_COUNT), pool_shards(SHARD_COUNT) {};
-	~ConcurrentChunkMap()
+			pool_shards(SHARD_COUNT)
 	{
-		pool_shards.clear();
-		map_shards.clear();
-	}
+		for (uint64_t shard_idx = 0; shard_idx < SHARD_COUNT; ++shard_idx)
+		{
+			map_shards.emplace_back(epochs);
+		}
+	};
+	~ConcurrentChunkMap();
 
-	// chunks_per_shard gets multiplied by SHARD_COUNT (e.g. 32 * 4000 = 128000 chunks)
+	// chunks_per_shard gets multiplied by SHARD_COUNT (e.g. 32 * 4000 = 128000 chunks).
+	// The pools commit memory as they're used, this is only for callers that want it all committed up front
 	void pre_allocate_chunks_per_shard(int chunks_per_shard)
 	{
 		for (const PoolShard& shard : pool_shards)
@@ -85,118 +82,149 @@ public:
 		}
 	}
 
-	std::vector<Vector3i> consume_dirty_list()
-	{
-		std::lock_guard lock(dirty_mutex);
-		std::vector<Vector3i> result(dirty_positions.begin(), dirty_positions.end());
-		result.clear();
-		return result;
-	}
-
-	// Returns a COPY of the data so the map can be unlocked immediately
-	// It's quick as the chunk uses a pointer for it's data
-	ChunkData* get_chunk(Vector3i pos)
+	// Gives the memory of pooled chunks back to the system where whole blocks of them are unused,
+	// keeping about keep_free_per_shard ready in each pool
+	void trim_pools(uint64_t keep_free_per_shard)
 	{
-		MapShard& shard = map_shards[get_shard(pos)];
-		std::shared_lock lock(shard.mutex);
-
-		auto it = shard.data.find(pos);
-		if (it != shard.data.end())
+		for (const PoolShard& shard : pool_shards)
 		{
-			return it->second.get();
+			shard.pool->trim(keep_free_per_shard);
 		}
-		return nullptr;
 	}
 
-	ChunkData* get_or_create(Vector3i pos)
-	{
-		if (ChunkData* existing_chunk = get_chunk(pos))
-		{
-			return existing_chunk;
-		}
-
-		// Take chunk from the pool and put it in the loaded chunks
-		uint64_t shard_idx = get_shard(pos);
-		PoolShard& pool_shard = pool_shards[shard_idx];
-		ChunkPtr new_ptr = pool_shard.pool->acquire();
+	// Take before looking up chunks that are kept or used off the main thread
+	EpochManager::Pin pin() const { return epochs.pin(); }
+	// Recycles the removed chunks and frees the region table arrays nothing pinned can reach anymore. Call regularly from
+	// one thread. Returns how many chunks
+	int64_t reclaim();
+
+	// Done by publish_snapshot. A position edited any number of times is listed once until the list is consumed
+	void mark_dirty(ChunkData* p_chunk);
+	// Takes the chunks marked dirty since the last call. Ones unloaded since then are left out
+	std::vector<Vector3i> consume_dirty_list();
+
+	ChunkData* get_chunk(Vector3i pos) const;
+	bool has_chunk(Vector3i pos) const { return get_chunk(pos) != nullptr; }
+	// Null until the generator is done with it too, for readers of the points and surface state. A chunk that's still
+	// being generated holds whatever its pool slot held before
+	const ChunkData* get_generated_chunk(const Vector3i& p_pos) const;
+	// Whether p_version is the version of the chunk loaded at p_pos, so what was built from it is still up to date.
+	// Versions aren't reused, so it's false for anything built before the chunk was unloaded, edited or reloaded
+	bool is_current(const Vector3i& p_pos, uint64_t p_version) const;
+	// The chunk at p_pos if it's still p_version, otherwise null. Hold a pin while using it
+	ChunkData* get_current(const Vector3i& p_pos, uint64_t p_version) const;
+	// Unloaded neighbours are null. At most 8 regions are looked up, the rest is indexing
+	void get_neighbourhood(const Vector3i& p_pos, Neighbourhood& r_neighbourhood) const;
+
+	// Concurrent calls for the same position all get the same chunk
+	ChunkData* get_or_create(Vector3i pos);
+	// r_chunks gets the chunk of each position in order, r_created whether this call created it. Only created chunks
+	// need generating, the rest are already generated or queued. Each shard is locked once and its missing chunks are
+	// taken from its pool in one go
+	void get_or_create_many(const std::vector<Vector3i>& p_positions, std::vector<ChunkData*>& r_chunks, std::vector<uint8_t>& r_created);
+	// r_contains gets whether each position is loaded, in order
+	void contains_many(const std::vector<Vector3i>& p_positions, std::vector<uint8_t>& r_contains) const;
+
+	// Copy-on-write edits. Chunks in the map aren't written to once they're generated, so tasks holding one keep a
+	// consistent snapshot. An edit takes an unpublished copy, writes to it and publishes it in the original's place.
+	// The copy has p_source's contents when there is one, otherwise it's left to be filled
+	ChunkData* acquire_snapshot(const Vector3i& p_pos, const ChunkData* p_source = nullptr);
+	// The chunk it replaces is retired, readers that have it pinned keep reading the old version.
+	// It gets a new version and is marked dirty before it's visible
+	void publish_snapshot(ChunkData* p_snapshot, bool p_mark_dirty = true);
+	// For a snapshot that ended up not being needed
+	void discard_snapshot(ChunkData* p_snapshot);
+
+	void unload_chunk(Vector3i pos);
+	// Each shard is locked once and its chunks go back to its pool in one go
+	void unload_many(const std::vector<Vector3i>& p_positions);
+	void unload_all();
+
+	int64_t get_loaded_count() const;
+	int64_t get_pool_count() const;
+	// Removed chunks waiting for reclaim
+	int64_t get_retired_count() const;
+	int64_t get_pin_count() const { return epochs.get_pin_count(); }
+	// Chunks that have memory committed, loaded or pooled
+	int64_t get_pool_capacity() const;
 
-		new_ptr->position = pos;
+private:
+	static constexpr uint64_t SHARD_BITS = 5;
+	static constexpr uint64_t SHARD_COUNT = 1ULL << SHARD_BITS;
 
-		MapShard& shard = map_shards[shard_idx];
-		std::unique_lock lock(shard.mutex);
-		ChunkData* new_chunk = new_ptr.get();
-		shard.data[pos] = std::move(new_ptr);
+	struct Region
+	{
+		// The key it's in the table under, EMPTY while it's free. Readers check it after reading a slot
+		std::atomic<uint64_t> key{ chunk_key::EMPTY };
+		std::array<std::atomic<ChunkData*>, REGION_VOLUME> chunks{};
+		uint32_t count = 0; // Guarded by the shard's write mutex
+	};
 
-		return new_chunk;
-	}
+	// Address space reserved per pool, about 2.4GB, nothing is committed until it's used
+	static constexpr uint64_t MAX_CHUNKS_PER_SHARD = 1 << 16;
 
-	bool has_chunk(Vector3i pos)
+	struct RetiredChunk
 	{
-		MapShard& shard = map_shards[get_shard(pos)];
-		std::shared_lock lock(shard.mutex);
-		return shard.data.contains(pos);
-	}
+		uint64_t epoch = 0;
+		ChunkData* chunk = nullptr;
+	};
 
-	void update_chunk(const ChunkData& modified_data, bool mark_dirty = true)
+	// Pool for unused chunks. A block is as many chunks as fit in one 2MB huge page
+	struct PoolShard
 	{
-		int64_t shard_idx = get_shard(modified_data.position);
-
-		// Create the new ptr before locking
-		PoolShard& pool_shard = pool_shards[shard_idx];
-		ChunkPtr new_ptr = pool_shard.pool->acquire();
+		std::shared_ptr<SafePool<ChunkData>> pool{ SafePool<ChunkData>::create(1, MAX_CHUNKS_PER_SHARD, true) };
+		std::vector<RetiredChunk> retired{}; // In the order they were retired, so by epoch
+		mutable std::mutex retired_mutex{};
+	};
 
-		// Shallow copy
-		*new_ptr = modified_data;
+	// Pins taken from it are held by tasks, it has to outlive them
+	mutable EpochManager epochs{};
 
-		{
-			MapShard& shard = map_shards[shard_idx];
-			std::unique_lock lock(shard.mutex);
-			// This replaces the ChunkPtr. It returns to the pool automatically.
-			shard.data[modified_data.position] = std::move(new_ptr);
-		}
+	std::atomic<uint64_t> next_version{ 1 };
+	uint64_t take_version() { return next_version.fetch_add(1, std::memory_order_relaxed); }
 
-		if (mark_dirty)
-		{
-			std::lock_guard lock(dirty_mutex);
-			dirty_positions.insert(modified_data.position);
-		}
-	}
+	std::vector<PoolShard> pool_shards;
 
-	void unload_chunk(Vector3i pos)
+	// The regions hold raw pointers, they go back to the shard's pool when they're removed
+	struct MapShard
 	{
-		MapShard& shard = map_shards[get_shard(pos)];
-		std::unique_lock lock(shard.mutex);
-		shard.data.erase(pos);
-	}
+		explicit MapShard(EpochManager& p_epochs) :
+				regions(p_epochs) {}
+
+		ChunkTable<Region> regions; // Its grown out arrays are freed by reclaim
+		std::mutex write_mutex{};
+		std::vector<std::unique_ptr<Region>> region_storage{}; // Every region the shard has made
+		std::vector<Region*> free_regions{};
+		std::atomic<int64_t> chunk_count = 0;
+	};
 
+	std::deque<MapShard> map_shards; // A deque so the shards can be made in place, they can't be moved
 
-	void unload_all()
-	{
-		for (MapShard& shard : map_shards)
-		{
-			std::shared_lock lock(shard.mutex);
-			shard.data.clear();
-		}
-	}
+	// Edited chunks waiting to be meshed again, each listed once while its is_dirty is set
+	std::vector<Vector3i> dirty_positions{};
+	std::mutex dirty_mutex{};
 
-	int64_t get_loaded_count() const
+	// A position's region and slot, worked out once for the batch operations
+	struct Location
 	{
-		int64_t count = 0;
-		for (const MapShard& shard : map_shards)
-		{
-			std::shared_lock lock(shard.mutex);
-			count += shard.data.size();
-		}
-		return count;
-	}
+		uint64_t region_key = 0;
+		uint64_t hash = 0;
+		uint32_t slot = 0;
+	};
 
-	int64_t get_pool_count() const
+	static Location locate(const Vector3i& p_pos);
+	static uint64_t get_shard(uint64_t p_hash)
 	{
-		int64_t count = 0;
-		for (const PoolShard& shard : pool_shards)
-		{
-			count += shard.pool->size();
-		}
-		return count;
+		return p_hash >> (64 - SHARD_BITS); // The table uses the low bits
 	}
+
+	// Indices into p_positions grouped by shard, shard i's are [r_shard_starts[i], r_shard_starts[i + 1])
+	static void bucket_by_shard(const std::vector<Vector3i>& p_positions, std::vector<Location>& r_locations, std::vector<uint32_t>& r_order, std::array<uint32_t, SHARD_COUNT + 1>& r_shard_starts);
+
+	ChunkData* find(const Location& p_location) const;
+	// Call after the chunks are out of the map
+	void retire(uint64_t p_shard_idx, const std::vector<ChunkData*>& p_chunks);
+	// The rest need the shard's write mutex
+	Region* get_or_add_region_locked(MapShard& p_shard, const Location& p_location);
+	ChunkData* remove_locked(MapShard& p_shard, const Location& p_location);
 };
@@ -0,0 +1,84 @@
+#include "delta_slabs.h"
+
+#include "chunk_shells.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using namespace godot;
+
+namespace delta_slabs
+{
+using chunk_shells::MAX_RADIUS;
+using chunk_shells::MIN_RADIUS;
+using chunk_shells::Shape;
+
+// 3x3x3 steps, the centre one is unused
+constexpr int32_t STEP_SLOTS = 27;
+constexpr uint64_t SHAPE_COUNT = static_cast<uint64_t>(Shape::Count);
+
+using Slabs = std::array<std::vector<Vector3i>, STEP_SLOTS>;
+
+static std::array<std::array<Slabs, MAX_RADIUS + 1>, SHAPE_COUNT> slabs_by_radius{};
+static std::array<std::array<std::once_flag, MAX_RADIUS + 1>, SHAPE_COUNT> built_flags{};
+
+static int32_t get_step_slot(const Vector3i& p_step)
+{
+	return (p_step.x + 1) + (p_step.y + 1) * 3 + (p_step.z + 1) * 9;
+}
+
+static void build(Shape p_shape, int32_t p_radius, Slabs& r_slabs)
+{
+	const chunk_shells::Shells& shells = chunk_shells::get_shells(p_shape);
+	const uint32_t end = shells.get_end(p_radius);
+	// Only offsets less than the longest step inside the edge can have come from outside, sqrt(3) for a sphere
+	const int32_t step_shells = static_cast<int32_t>(shells.get_step_shells(Vector3i(1, 1, 1)));
+	const uint32_t start = shells.ranges[std::max(p_radius - step_shells - MIN_RADIUS, 0)].start;
+
+	for (int32_t z = -1; z <= 1; ++z)
+	{
+		for (int32_t y = -1; y <= 1; ++y)
+		{
+			for (int32_t x = -1; x <= 1; ++x)
+			{
+				const Vector3i step(x, y, z);
+				if (!is_step(step))
+				{
+					continue;
+				}
+
+				std::vector<Vector3i>& slab = r_slabs[get_step_slot(step)];
+				for (uint32_t i = start; i < end; ++i)
+				{
+					const Vector3i offset = shells.offsets[i];
+					if (!shells.contains(offset + step, p_radius))
+					{
+						slab.push_back(offset);
+					}
+				}
+				slab.shrink_to_fit();
+			}
+		}
+	}
+}
+
+bool is_step(const Vector3i& p_step)
+{
+	return p_step != Vector3i() && p_step.x >= -1 && p_step.x <= 1 && p_step.y >= -1 && p_step.y <= 1 && p_step.z >= -1 && p_step.z <= 1;
+}
+
+const std::vector<Vector3i>& get_entering(Shape p_shape, int32_t p_radius, const Vector3i& p_step)
+{
+	const uint64_t shape = std::min(static_cast<uint64_t>(p_shape), SHAPE_COUNT - 1);
+	const int32_t radius = std::clamp(p_radius, MIN_RADIUS, MAX_RADIUS);
+	Slabs& slabs = slabs_by_radius[shape][radius];
+	std::call_once(built_flags[shape][radius], build, static_cast<Shape>(shape), radius, std::ref(slabs));
+	return slabs[get_step_slot(p_step)];
+}
+} //namespace delta_slabs
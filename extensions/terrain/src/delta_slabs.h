@@ -0,0 +1,21 @@
+#pragma once
+
+#include "chunk_shells.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// The offsets that enter a chunk_shells shape when its centre takes a single step, one slab for each of the
+// 26 neighbouring steps. Used to update a moving viewer without walking its whole sphere, see ChunkInterest.
+namespace delta_slabs
+{
+// True when every component of p_step is -1, 0 or 1 and it isn't zero
+bool is_step(const godot::Vector3i& p_step);
+
+// Offsets from the new centre that were outside the shape around the old centre, closest first.
+// The offsets leaving the shape are the slab of the opposite step, from the old centre.
+// All 26 slabs of a shape and radius are built the first time it's used. Thread safe
+const std::vector<godot::Vector3i>& get_entering(chunk_shells::Shape p_shape, int32_t p_radius, const godot::Vector3i& p_step);
+} //namespace delta_slabs
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief Epoch based reclamation, tells when memory taken out of a shared structure can be reused
+ * Anything that reads the structure, or holds a pointer it got from it, holds a Pin. A Pin counts itself in the epoch
+ * it was taken in, and can be copied along with the pointer to other threads. Hold them briefly, a single pin left
+ * from the previous epoch stops it moving on and nothing retired since can be reused.
+ * Memory is retired with the epoch it was removed in, and is safe to reuse once the epoch has moved on twice since.
+ * The epoch only moves on when no pins are left from the one before, so nothing pinned can still reach it.
+ * The pins only count per epoch, taking one is an increment on a shared counter, there's no per thread registration.
+ * Pins must not outlive their manager.
+ */
+class EpochManager
+{
+public:
+	class Pin
+	{
+	public:
+		Pin() = default;
+		~Pin() { reset(); }
+
+		// A copy pins the same epoch, which can't have been left behind while this one holds it
+		Pin(const Pin& p_other) :
+				manager(p_other.manager), epoch(p_other.epoch)
+		{
+			if (manager) manager->add_pin(epoch);
+		}
+
+		Pin& operator=(const Pin& p_other)
+		{
+			if (this != &p_other)
+			{
+				if (p_other.manager) p_other.manager->add_pin(p_other.epoch);
+				reset();
+				manager = p_other.manager;
+				epoch = p_other.epoch;
+			}
+			return *this;
+		}
+
+		Pin(Pin&& p_other) noexcept :
+				manager(std::exchange(p_other.manager, nullptr)), epoch(p_other.epoch) {}
+
+		Pin& operator=(Pin&& p_other) noexcept
+		{
+			if (this != &p_other)
+			{
+				reset();
+				manager = std::exchange(p_other.manager, nullptr);
+				epoch = p_other.epoch;
+			}
+			return *this;
+		}
+
+		bool is_pinned() const { return manager != nullptr; }
+		uint64_t get_epoch() const { return epoch; }
+
+		void reset()
+		{
+			if (manager)
+			{
+				manager->remove_pin(epoch);
+				manager = nullptr;
+			}
+		}
+
+	private:
+		friend class EpochManager;
+
+		Pin(EpochManager* p_manager, uint64_t p_epoch) :
+				manager(p_manager), epoch(p_epoch) {}
+
+		EpochManager* manager = nullptr;
+		uint64_t epoch = 0;
+	};
+
+	EpochManager() = default;
+	EpochManager(const EpochManager&) = delete;
+	EpochManager& operator=(const EpochManager&) = delete;
+
+	// Take it before reading anything that can be retired
+	Pin pin()
+	{
+		while (true)
+		{
+			const uint64_t current = epoch.load(std::memory_order_seq_cst);
+			add_pin(current);
+			// Counted too late if the epoch moved on in between, the next one's pins are counted elsewhere
+			if (epoch.load(std::memory_order_seq_cst) == current)
+			{
+				return Pin(this, current);
+			}
+			remove_pin(current);
+		}
+	}
+
+	// The epoch to retire memory with, after it's been made unreachable
+	uint64_t get_epoch() const { return epoch.load(std::memory_order_seq_cst); }
+
+	// Moves the epoch on if no pins are left from the one before. Returns the epoch it's in
+	uint64_t try_advance()
+	{
+		uint64_t current = epoch.load(std::memory_order_seq_cst);
+		if (current == 0 || pin_counts[(current - 1) % EPOCH_SLOTS].count.load(std::memory_order_seq_cst) == 0)
+		{
+			// Only one advance can win, a loser sees the epoch it moved to
+			epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+			return epoch.load(std::memory_order_seq_cst);
+		}
+		return current;
+	}
+
+	// Whether memory retired in p_retire_epoch can't be reached by anything pinned anymore
+	bool is_safe(uint64_t p_retire_epoch) const { return epoch.load(std::memory_order_seq_cst) >= p_retire_epoch + 2; }
+
+	int64_t get_pin_count() const
+	{
+		int64_t count = 0;
+		for (const PinCount& pin_count : pin_counts)
+		{
+			count += pin_count.count.load(std::memory_order_relaxed);
+		}
+		return count;
+	}
+
+private:
+	// Pins are only ever in the current epoch or the one before, a third slot is free to be emptied for the next
+	static constexpr uint64_t EPOCH_SLOTS = 3;
+
+	struct alignas(64) PinCount
+	{
+		std::atomic<int64_t> count{ 0 };
+	};
+
+	void add_pin(uint64_t p_epoch) { pin_counts[p_epoch % EPOCH_SLOTS].count.fetch_add(1, std::memory_order_seq_cst); }
+	void remove_pin(uint64_t p_epoch) { pin_counts[p_epoch % EPOCH_SLOTS].count.fetch_sub(1, std::memory_order_release); }
+
+	alignas(64) std::atomic<uint64_t> epoch{ 0 };
+	std::array<PinCount, EPOCH_SLOTS> pin_counts{};
+};
@@ -0,0 +1,90 @@
+#include "face_connectivity.h"
+
+#include "terrain_constants.h"
+
+#include <array>
+#include <cstdint>
+
+using namespace terrain_constants;
+
+namespace face_connectivity
+{
+// Same threshold as the mesher, below it is air
+constexpr uint8_t AIR_THRESHOLD = static_cast<uint8_t>(ISO_LEVEL * 255.0f + 0.5f);
+
+static thread_local std::array<uint8_t, POINTS_VOLUME> visited;
+static thread_local std::array<int32_t, POINTS_VOLUME> stack;
+
+uint16_t compute(const uint8_t* p_points)
+{
+	visited.fill(0);
+	uint16_t connectivity = NONE_CONNECTED;
+
+	for (int32_t start = 0; start < POINTS_VOLUME; ++start)
+	{
+		if (visited[start] || p_points[start] >= AIR_THRESHOLD)
+		{
+			continue;
+		}
+
+		// Flood fill one air pocket and record every face it touches
+		uint8_t touched_faces = 0;
+		int32_t stack_size = 0;
+		stack[stack_size++] = start;
+		visited[start] = 1;
+
+		while (stack_size > 0)
+		{
+			const int32_t index = stack[--stack_size];
+			const int32_t x = index % POINTS_SIZE;
+			const int32_t y = (index / POINTS_SIZE) % POINTS_SIZE;
+			const int32_t z = index / POINTS_AREA;
+
+			touched_faces |= (x == 0) << NEG_X;
+			touched_faces |= (x == POINTS_SIZE - 1) << POS_X;
+			touched_faces |= (y == 0) << NEG_Y;
+			touched_faces |= (y == POINTS_SIZE - 1) << POS_Y;
+			touched_faces |= (z == 0) << NEG_Z;
+			touched_faces |= (z == POINTS_SIZE - 1) << POS_Z;
+
+			auto visit = [&](int32_t p_neighbour)
+			{
+				if (!visited[p_neighbour] && p_points[p_neighbour] < AIR_THRESHOLD)
+				{
+					visited[p_neighbour] = 1;
+					stack[stack_size++] = p_neighbour;
+				}
+			};
+
+			if (x > 0) visit(index - 1);
+			if (x < POINTS_SIZE - 1) visit(index + 1);
+			if (y > 0) visit(index - POINTS_SIZE);
+			if (y < POINTS_SIZE - 1) visit(index + POINTS_SIZE);
+			if (z > 0) visit(index - POINTS_AREA);
+			if (z < POINTS_SIZE - 1) visit(index + POINTS_AREA);
+		}
+
+		for (int32_t a = 0; a < FACE_COUNT; ++a)
+		{
+			if (!(touched_faces & (1 << a)))
+			{
+				continue;
+			}
+			for (int32_t b = a + 1; b < FACE_COUNT; ++b)
+			{
+				if (touched_faces & (1 << b))
+				{
+					connectivity |= get_pair_bit(static_cast<Face>(a), static_cast<Face>(b));
+				}
+			}
+		}
+
+		if (connectivity == ALL_CONNECTED)
+		{
+			break;
+		}
+	}
+
+	return connectivity;
+}
+} //namespace face_connectivity
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+
+// Which faces of a chunk are connected to each other through air, one bit per pair of the 6 faces.
+// Used to cull chunks that can't be seen through open space, see CaveCulling.
+namespace face_connectivity
+{
+enum Face : uint8_t
+{
+	NEG_X,
+	POS_X,
+	NEG_Y,
+	POS_Y,
+	NEG_Z,
+	POS_Z,
+	FACE_COUNT
+};
+
+constexpr uint16_t NONE_CONNECTED = 0;
+constexpr uint16_t ALL_CONNECTED = (1 << 15) - 1; // 15 face pairs
+
+constexpr Face get_opposite(Face p_face) { return static_cast<Face>(p_face ^ 1); }
+
+inline godot::Vector3i get_direction(Face p_face)
+{
+	constexpr int32_t directions[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+	return godot::Vector3i(directions[p_face][0], directions[p_face][1], directions[p_face][2]);
+}
+
+constexpr uint16_t get_pair_bit(Face p_a, Face p_b)
+{
+	const int32_t low = p_a < p_b ? p_a : p_b;
+	const int32_t high = p_a < p_b ? p_b : p_a;
+	// Index of (low, high) in the upper triangle of a 6x6 matrix without the diagonal
+	const int32_t index = low * (2 * FACE_COUNT - low - 1) / 2 + (high - low - 1);
+	return static_cast<uint16_t>(1 << index);
+}
+
+constexpr bool are_connected(uint16_t p_connectivity, Face p_a, Face p_b)
+{
+	return p_a == p_b || (p_connectivity & get_pair_bit(p_a, p_b)) != 0;
+}
+
+// Flood fills the air points of a chunk, p_points is POINTS_VOLUME long. Thread safe
+uint16_t compute(const uint8_t* p_points);
+} //namespace face_connectivity
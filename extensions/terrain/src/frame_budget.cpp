@@ -0,0 +1,140 @@
+#include "frame_budget.h"
+
+#include <godot_cpp/classes/display_server.hpp>
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/time.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace godot;
+
+constexpr uint64_t MIN_BUDGET_USEC = 500;
+constexpr uint64_t BUDGET_INCREASE_USEC = 100;
+// Never give applies more than this fraction of the frame
+constexpr float MAX_BUDGET_FRACTION = 0.25f;
+// A frame this much longer than the target counts as a miss
+constexpr float HITCH_THRESHOLD = 1.25f;
+// How often the refresh rate is queried again, in frames
+constexpr uint64_t TARGET_UPDATE_INTERVAL = 256;
+
+void FrameBudget::reset()
+{
+	update_target_frame_usec();
+
+	budget_usec = std::max<uint64_t>(MIN_BUDGET_USEC, static_cast<uint64_t>(target_frame_usec * MAX_BUDGET_FRACTION));
+	frame_start_usec = 0;
+	frame_count = 0;
+	apply_cost_usec.fill(0.0f);
+	applied_count.fill(0);
+	last_applied_count.fill(0);
+	hitch_counts.fill(0);
+}
+
+void FrameBudget::begin_frame()
+{
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+
+	if (frame_count % TARGET_UPDATE_INTERVAL == 0)
+	{
+		update_target_frame_usec();
+	}
+	++frame_count;
+
+	if (frame_start_usec != 0)
+	{
+		const float frame_ratio = static_cast<float>(now - frame_start_usec) / target_frame_usec;
+
+		int64_t bucket = 0;
+		if (frame_ratio > 4.0f)
+		{
+			bucket = 3;
+		}
+		else if (frame_ratio > 2.0f)
+		{
+			bucket = 2;
+		}
+		else if (frame_ratio > HITCH_THRESHOLD)
+		{
+			bucket = 1;
+		}
+		++hitch_counts[bucket];
+
+		const uint64_t max_budget = std::max<uint64_t>(MIN_BUDGET_USEC, static_cast<uint64_t>(target_frame_usec * MAX_BUDGET_FRACTION));
+		if (bucket > 0)
+		{
+			budget_usec = std::max(MIN_BUDGET_USEC, budget_usec / 2);
+		}
+		else
+		{
+			budget_usec = std::min(max_budget, budget_usec + BUDGET_INCREASE_USEC);
+		}
+	}
+
+	frame_start_usec = now;
+	last_applied_count = applied_count;
+	applied_count.fill(0);
+}
+
+bool FrameBudget::can_apply(Priority p_priority) const
+{
+	const size_t index = static_cast<size_t>(p_priority);
+	if (p_priority == Priority::Near && applied_count[index] == 0)
+	{
+		return true; // Always make progress on what's closest
+	}
+
+	const uint64_t elapsed = Time::get_singleton()->get_ticks_usec() - frame_start_usec;
+	return elapsed + static_cast<uint64_t>(apply_cost_usec[index]) <= budget_usec;
+}
+
+void FrameBudget::applied(Priority p_priority, uint64_t p_start_usec)
+{
+	const size_t index = static_cast<size_t>(p_priority);
+	const float cost = static_cast<float>(Time::get_singleton()->get_ticks_usec() - p_start_usec);
+
+	constexpr float alpha = 0.1f;
+	if (apply_cost_usec[index] == 0.0f)
+	{
+		apply_cost_usec[index] = cost;
+	}
+	else
+	{
+		apply_cost_usec[index] = (cost * alpha) + (apply_cost_usec[index] * (1.0f - alpha));
+	}
+
+	++applied_count[index];
+}
+
+int64_t FrameBudget::get_hitch_count(int64_t p_bucket) const
+{
+	if (p_bucket < 0 || p_bucket >= HITCH_BUCKET_COUNT)
+	{
+		return 0;
+	}
+	return hitch_counts[p_bucket];
+}
+
+void FrameBudget::update_target_frame_usec()
+{
+	double refresh_rate = 60.0;
+
+	DisplayServer* display_server = DisplayServer::get_singleton();
+	if (display_server)
+	{
+		const double screen_refresh_rate = display_server->screen_get_refresh_rate();
+		if (screen_refresh_rate > 0.0)
+		{
+			refresh_rate = screen_refresh_rate;
+		}
+	}
+
+	// A frame rate cap below the refresh rate is the real target
+	const int32_t max_fps = Engine::get_singleton()->get_max_fps();
+	if (max_fps > 0 && max_fps < refresh_rate)
+	{
+		refresh_rate = max_fps;
+	}
+
+	target_frame_usec = static_cast<uint64_t>(1000000.0 / refresh_rate);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Adapts how much main thread time chunk applies get each frame
+ * The budget grows slowly while frames are on time and halves when a frame misses the target refresh rate.
+ * Applies are split into priority classes. Higher priority classes are applied first and can use the whole budget,
+ * lower ones get what is left. Main thread only.
+ */
+class FrameBudget
+{
+public:
+	enum class Priority : uint8_t
+	{
+		Near, // Meshes around the viewer
+		Far, // All other meshes
+		Regions, // Region mesh draw state updates
+		Count
+	};
+
+	// Frame time as a multiple of the target: on time, over 1.25x, over 2x, over 4x
+	static constexpr int64_t HITCH_BUCKET_COUNT = 4;
+
+	void reset();
+
+	// Call once per frame before any applies, measures the last frame and adapts the budget
+	void begin_frame();
+
+	// Whether the next apply of this class is expected to fit in what is left of the budget
+	bool can_apply(Priority p_priority) const;
+	// Call after each apply with the time it started, used to estimate the cost of the next one
+	void applied(Priority p_priority, uint64_t p_start_usec);
+
+	uint64_t get_budget_usec() const { return budget_usec; }
+	uint64_t get_target_frame_usec() const { return target_frame_usec; }
+	int64_t get_hitch_count(int64_t p_bucket) const;
+	int64_t get_applied_count(Priority p_priority) const { return last_applied_count[static_cast<size_t>(p_priority)]; }
+
+private:
+	void update_target_frame_usec();
+
+	static constexpr size_t PRIORITY_COUNT = static_cast<size_t>(Priority::Count);
+
+	uint64_t budget_usec = 4000;
+	uint64_t target_frame_usec = 16667;
+
+	uint64_t frame_start_usec = 0;
+	uint64_t frame_count = 0;
+
+	// Moving average cost of a single apply in each class
+	std::array<float, PRIORITY_COUNT> apply_cost_usec{};
+	std::array<int64_t, PRIORITY_COUNT> applied_count{};
+	std::array<int64_t, PRIORITY_COUNT> last_applied_count{};
+
+	std::array<int64_t, HITCH_BUCKET_COUNT> hitch_counts{};
+};
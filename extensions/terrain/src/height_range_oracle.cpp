@@ -0,0 +1,128 @@
+#include "height_range_oracle.h"
+
+#include "chunk_data.h"
+#include "chunk_generator.h"
+#include "face_connectivity.h"
+#include "terrain_constants.h"
+
+#include <godot_cpp/classes/fast_noise_lite.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+using namespace godot;
+using namespace terrain_constants;
+
+HeightRangeOracle::HeightRangeOracle(const Ref<ChunkGeneratorSettings>& p_settings)
+{
+	// Its own copy, so setting the noise offsets doesn't race the generator threads
+	if (p_settings.is_valid())
+	{
+		settings = p_settings->duplicate(true);
+	}
+}
+
+SurfaceState HeightRangeOracle::classify(const Vector3i& p_chunk_pos) const
+{
+	const HeightRange range = get_height_range(p_chunk_pos.x, p_chunk_pos.z);
+	if (!range.is_valid)
+	{
+		return SurfaceState::MIXED;
+	}
+
+	// A point is clamp(height - y, 0, 1), see ChunkGenerator::process_task
+	const float bottom_y = static_cast<float>(p_chunk_pos.y * CHUNK_SIZE);
+	const float top_y = bottom_y + static_cast<float>(POINTS_SIZE - 1);
+	if (range.max <= bottom_y)
+	{
+		return SurfaceState::EMPTY;
+	}
+	if (range.min >= top_y + 1.0f)
+	{
+		return SurfaceState::FULL;
+	}
+	return SurfaceState::MIXED;
+}
+
+void HeightRangeOracle::fill_uniform(ChunkData& r_chunk_data, SurfaceState p_surface_state)
+{
+	const bool is_full = p_surface_state == SurfaceState::FULL;
+	r_chunk_data.points.fill(is_full ? 255 : 0);
+	r_chunk_data.surface_sum = is_full ? POINTS_VOLUME * 255 : 0;
+	r_chunk_data.surface_state = is_full ? SurfaceState::FULL : SurfaceState::EMPTY;
+	r_chunk_data.face_connectivity = is_full ? face_connectivity::NONE_CONNECTED : face_connectivity::ALL_CONNECTED;
+	r_chunk_data.is_generated.store(true, std::memory_order_release);
+}
+
+int64_t HeightRangeOracle::get_column_count() const
+{
+	std::shared_lock lock(columns_mutex);
+	return columns.size();
+}
+
+HeightRangeOracle::HeightRange HeightRangeOracle::get_height_range(int32_t p_chunk_x, int32_t p_chunk_z) const
+{
+	const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(p_chunk_x)) << 32) | static_cast<uint32_t>(p_chunk_z);
+	{
+		std::shared_lock lock(columns_mutex);
+		auto it = columns.find(key);
+		if (it != columns.end())
+		{
+			return it->second;
+		}
+	}
+
+	const HeightRange range = compute_height_range(p_chunk_x, p_chunk_z);
+
+	std::unique_lock lock(columns_mutex);
+	if (columns.size() >= MAX_COLUMNS)
+	{
+		columns.clear();
+	}
+	columns.emplace(key, range);
+	return range;
+}
+
+HeightRangeOracle::HeightRange HeightRangeOracle::compute_height_range(int32_t p_chunk_x, int32_t p_chunk_z) const
+{
+	HeightRange range{};
+	if (!settings.is_valid() || !settings->height_base_noise.is_valid() || !settings->height_multiplier_noise.is_valid())
+	{
+		return range; // The generator reports the missing noise, every chunk is left to it
+	}
+
+	std::lock_guard lock(noise_mutex);
+
+	// The same samples as ChunkGenerator::generate_height_map so the heights match exactly
+	FastNoiseLite* base_noise_ptr = settings->height_base_noise.ptr();
+	FastNoiseLite* mult_noise_ptr = settings->height_multiplier_noise.ptr();
+	const Vector3 offset(static_cast<float>(p_chunk_x * CHUNK_SIZE), static_cast<float>(p_chunk_z * CHUNK_SIZE), 0);
+	base_noise_ptr->set_offset(offset);
+	mult_noise_ptr->set_offset(offset);
+
+	const float base_offset = settings->base_height_offset;
+	const float base_mult = settings->base_height_multiplier;
+
+	range.min = 1e30f;
+	range.max = -1e30f;
+	for (int z = 0; z < POINTS_SIZE; z++)
+	{
+		for (int x = 0; x < POINTS_SIZE; x++)
+		{
+			float height_base = base_noise_ptr->get_noise_2d(x, z);
+			float height_mult = mult_noise_ptr->get_noise_2d(x, z);
+
+			float height_offset = base_offset + 100.0f * height_mult;
+			float height = height_offset + height_base * base_mult;
+			range.min = std::min(range.min, height);
+			range.max = std::max(range.max, height);
+		}
+	}
+	range.is_valid = true;
+	return range;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "chunk_data.h"
+#include "chunk_generator.h"
+
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+using namespace godot;
+
+/**
+ * @brief Tells which chunks the generator would fill with only air or only rock, without generating them
+ * The terrain is a height field, so a chunk is uniform when its whole column of heights is above or below it.
+ * The min and max height of each chunk column are worked out once with the same noise samples as ChunkGenerator and
+ * cached, every chunk stacked in that column shares them. Sampling the noise any coarser could miss a peak and leave a hole.
+ * Chunks it calls uniform don't have to be created or generated, see ChunkInterest. Unloaded chunks it calls FULL are
+ * treated as rock by the raycasts and cave culling.
+ * Can be used from any thread.
+ */
+class HeightRangeOracle
+{
+public:
+	explicit HeightRangeOracle(const Ref<ChunkGeneratorSettings>& p_settings);
+
+	// EMPTY or FULL when the generator always gives that, otherwise MIXED
+	SurfaceState classify(const Vector3i& p_chunk_pos) const;
+	bool is_uniform(const Vector3i& p_chunk_pos) const { return classify(p_chunk_pos) != SurfaceState::MIXED; }
+
+	// Sets the points and state of a chunk to what the generator would give a uniform chunk
+	static void fill_uniform(ChunkData& r_chunk_data, SurfaceState p_surface_state);
+
+	int64_t get_column_count() const;
+
+private:
+	struct HeightRange
+	{
+		float min = 0.0f;
+		float max = 0.0f;
+		bool is_valid = false; // False when the noise isn't set, nothing is uniform then
+	};
+
+	// Past this the cache is dropped, a column is cheap to work out again
+	static constexpr uint64_t MAX_COLUMNS = 65536;
+
+	HeightRange get_height_range(int32_t p_chunk_x, int32_t p_chunk_z) const;
+	HeightRange compute_height_range(int32_t p_chunk_x, int32_t p_chunk_z) const;
+
+	mutable std::unordered_map<uint64_t, HeightRange> columns{};
+	mutable std::shared_mutex columns_mutex{};
+
+	// The noise offset is set per column, so sampling is serialised
+	Ref<ChunkGeneratorSettings> settings;
+	mutable std::mutex noise_mutex{};
+};
@@ -1,6 +1,7 @@
 #include "mesh_generator.h"
 
 #include "chunk_data.h"
+#include "concurrent_chunk_map.h"
 #include "godot_utility.h"
 #include "terrain_constants.h"
 
@@ -162,10 +163,19 @@ bool MeshGenerator::init()
 	return true;
 }
 
-MeshData MeshGenerator::process_task(ChunkData* chunk_data)
+MeshData MeshGenerator::process_task(ChunkTask p_task)
 {
 	MeshData mesh_data{};
-	mesh_data.chunk_pos = chunk_data->position;
+	mesh_data.chunk_pos = p_task.position;
+	mesh_data.chunk_version = p_task.version;
+
+	// Only pinned until the points are copied, not while the GPU works
+	EpochManager::Pin pin = chunk_map->pin();
+	const ChunkData* chunk_data = chunk_map->get_current(p_task.position, p_task.version);
+	if (!chunk_data)
+	{
+		return mesh_data; // A newer version is queued behind it, or it was unloaded
+	}
 
 	// No mesh to generate if the chunk is entirely empty or full
 	// TODO: Rework this check when we need to generate with the surrounding chunks
@@ -202,6 +212,7 @@ MeshData MeshGenerator::process_task(ChunkData* chunk_data)
 	PackedByteArray points_byte_array;
 	points_byte_array.resize(POINTS_VOLUME);
 	std::memcpy(points_byte_array.ptrw(), chunk_data->points.data(), terrain_constants::POINTS_VOLUME);
+	pin.reset();
 
 	// update the points buffer
 	local_rendering_device->texture_update(points_buffer, 0, points_byte_array);
@@ -236,7 +247,8 @@ MeshData MeshGenerator::process_task(ChunkData* chunk_data)
 
 	mesh_data.vertex_count = vertex_count;
 
-	if (vertex_count > 0)
+	// Edits land while the GPU works, there's no point reading back and building a mesh that won't be applied
+	if (vertex_count > 0 && chunk_map->is_current(mesh_data.chunk_pos, mesh_data.chunk_version))
 	{
 		Array mesh_arrays{};
 		mesh_arrays.resize(Mesh::ARRAY_MAX);
@@ -251,8 +263,20 @@ MeshData MeshGenerator::process_task(ChunkData* chunk_data)
 		mesh_arrays[Mesh::ARRAY_COLOR] = colour_data.to_color_array();
 
 		// Create the mesh
-		mesh_data.array_mesh.instantiate();
+		if (array_mesh_pool)
+		{
+			mesh_data.array_mesh = array_mesh_pool->acquire();
+			mesh_data.array_mesh->clear_surfaces();
+		}
+		else
+		{
+			mesh_data.array_mesh.instantiate();
+		}
 		mesh_data.array_mesh->add_surface_from_arrays(Mesh::PrimitiveType::PRIMITIVE_TRIANGLES, mesh_arrays);
+		if (keep_mesh_arrays)
+		{
+			mesh_data.mesh_arrays = mesh_arrays;
+		}
 	}
 
 	return mesh_data;
@@ -2,6 +2,7 @@
 
 #include "abstract_task_processer.h"
 #include "chunk_data.h"
+#include "resource_pool.h"
 
 #include <godot_cpp/classes/array_mesh.hpp>
 #include <godot_cpp/classes/rd_sampler_state.hpp>
@@ -14,21 +15,27 @@
 #include <godot_cpp/classes/rendering_device.hpp>
 #include <godot_cpp/classes/wrapped.hpp>
 #include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/variant/array.hpp>
 #include <godot_cpp/variant/rid.hpp>
 #include <godot_cpp/variant/vector3i.hpp>
 
 #include <cstdint>
+#include <memory>
 
 using namespace godot;
 
+class ConcurrentChunkMap;
+
 struct MeshData
 {
 	Vector3i chunk_pos{};
+	uint64_t chunk_version = 0; // The ChunkData::version it was built from, outdated meshes aren't applied
 	Ref<ArrayMesh> array_mesh;
+	Array mesh_arrays; // The arrays array_mesh was built from, only kept for region meshes to merge
 	uint32_t vertex_count = 0;
 };
 
-class MeshGenerator final : public ITaskProcessor<ChunkData*, MeshData>
+class MeshGenerator final : public ITaskProcessor<ChunkTask, MeshData>
 {
 	GDCLASS(MeshGenerator, RefCounted)
 
@@ -39,19 +46,29 @@ public:
 	// Call once to setup. Creates local rendering device, loads shader, and setups the buffers and uniforms
 	bool init();
 
-	static Ref<MeshGenerator> create()
+	// The chunks are looked up in p_chunk_map when their task starts, ones edited or unloaded while they were queued
+	// aren't meshed, see ConcurrentChunkMap::get_current. Meshes are taken from p_array_mesh_pool when one is given.
+	// p_keep_mesh_arrays fills MeshData::mesh_arrays, only region merging needs them
+	static Ref<MeshGenerator> create(std::shared_ptr<const ConcurrentChunkMap> p_chunk_map, std::shared_ptr<ResourcePool<ArrayMesh>> p_array_mesh_pool = nullptr, bool p_keep_mesh_arrays = false)
 	{
 		Ref<MeshGenerator> mesh_generator = memnew((MeshGenerator));
+		mesh_generator->chunk_map = std::move(p_chunk_map);
+		mesh_generator->array_mesh_pool = std::move(p_array_mesh_pool);
+		mesh_generator->keep_mesh_arrays = p_keep_mesh_arrays;
 		mesh_generator->init();
 		return mesh_generator;
 	}
 
-	virtual MeshData process_task(ChunkData* chunk_data) override;
+	virtual MeshData process_task(ChunkTask p_task) override;
 
 protected:
 	static void _bind_methods() {};
 
 private:
+	std::shared_ptr<const ConcurrentChunkMap> chunk_map;
+	std::shared_ptr<ResourcePool<ArrayMesh>> array_mesh_pool;
+	bool keep_mesh_arrays = false;
+
 	RenderingDevice* local_rendering_device = nullptr;
 
 	uint64_t rendering_thread_id = -1;
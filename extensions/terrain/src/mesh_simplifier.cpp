@@ -0,0 +1,290 @@
+#include "mesh_simplifier.h"
+
+#include "terrain_constants.h"
+
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using namespace godot;
+using namespace terrain_constants;
+
+void MeshSimplifier::Quadric::add(const Quadric& p_other)
+{
+	a2 += p_other.a2;
+	ab += p_other.ab;
+	ac += p_other.ac;
+	ad += p_other.ad;
+	b2 += p_other.b2;
+	bc += p_other.bc;
+	bd += p_other.bd;
+	c2 += p_other.c2;
+	cd += p_other.cd;
+	d2 += p_other.d2;
+}
+
+double MeshSimplifier::Quadric::error(const Vector3& p_point) const
+{
+	const double x = p_point.x;
+	const double y = p_point.y;
+	const double z = p_point.z;
+
+	double result = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+			+ b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+			+ c2 * z * z + 2.0 * cd * z
+			+ d2;
+
+	// Rounding can push a zero error slightly negative
+	return result > 0.0 ? result : 0.0;
+}
+
+void MeshSimplifier::simplify(std::vector<Vector3>& r_vertices, std::vector<uint32_t>& r_indices, int64_t p_target_triangle_count, float p_max_error)
+{
+	const bool has_budget = p_target_triangle_count > 0;
+	const bool has_error_bound = p_max_error > 0.0f;
+	if (!has_budget && !has_error_bound)
+	{
+		return;
+	}
+
+	const int64_t target_triangle_count = has_budget ? p_target_triangle_count : 0;
+	int64_t triangle_count = static_cast<int64_t>(r_indices.size() / 3);
+	if (triangle_count <= target_triangle_count)
+	{
+		return;
+	}
+
+	// Quadric error is the sum of squared distances to the original planes
+	const double max_cost = has_error_bound ? static_cast<double>(p_max_error) * p_max_error : std::numeric_limits<double>::max();
+
+	const size_t vertex_count = r_vertices.size();
+	build_quadrics(r_vertices, r_indices);
+	build_locks(r_vertices, r_indices);
+
+	remap.resize(vertex_count);
+	touched.resize(vertex_count);
+
+	// Each pass collapses a set of independent edges, cheapest first, then compacts the index buffer
+	while (triangle_count > target_triangle_count)
+	{
+		build_adjacency(vertex_count, r_indices);
+
+		collapses.clear();
+		for (size_t i = 0; i < r_indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				// With consistent winding the opposite triangle adds the other direction of this edge
+				uint32_t from = r_indices[i + e];
+				uint32_t to = r_indices[i + (e + 1) % 3];
+				if (locked[from])
+				{
+					continue;
+				}
+
+				Quadric quadric = quadrics[from];
+				quadric.add(quadrics[to]);
+				collapses.push_back({ from, to, quadric.error(r_vertices[to]) });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+				{ return a.cost < b.cost; });
+
+		std::fill(touched.begin(), touched.end(), 0);
+		for (uint32_t i = 0; i < vertex_count; ++i)
+		{
+			remap[i] = i;
+		}
+
+		int64_t collapse_count = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (triangle_count <= target_triangle_count || collapse.cost > max_cost)
+			{
+				break;
+			}
+
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			if (flips_triangle(r_vertices, r_indices, collapse.from, collapse.to))
+			{
+				continue;
+			}
+
+			// Lock the surrounding vertices for the rest of this pass, so the flip check stays valid
+			for (uint32_t k = adjacency_offsets[collapse.from]; k < adjacency_offsets[collapse.from + 1]; ++k)
+			{
+				const uint32_t* triangle = &r_indices[adjacency[k] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					triangle_count--; // Triangles on the collapsed edge become degenerate
+				}
+				touched[triangle[0]] = 1;
+				touched[triangle[1]] = 1;
+				touched[triangle[2]] = 1;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			collapse_count++;
+		}
+
+		if (collapse_count == 0)
+		{
+			break; // Nothing left that fits in the error bound
+		}
+
+		// Apply the collapses and remove the degenerate triangles
+		size_t write_index = 0;
+		for (size_t i = 0; i < r_indices.size(); i += 3)
+		{
+			uint32_t a = remap[r_indices[i]];
+			uint32_t b = remap[r_indices[i + 1]];
+			uint32_t c = remap[r_indices[i + 2]];
+			if (a == b || b == c || c == a)
+			{
+				continue;
+			}
+			r_indices[write_index++] = a;
+			r_indices[write_index++] = b;
+			r_indices[write_index++] = c;
+		}
+		r_indices.resize(write_index);
+		triangle_count = static_cast<int64_t>(write_index / 3);
+	}
+}
+
+void MeshSimplifier::build_quadrics(const std::vector<Vector3>& p_vertices, const std::vector<uint32_t>& p_indices)
+{
+	quadrics.assign(p_vertices.size(), Quadric{});
+
+	for (size_t i = 0; i < p_indices.size(); i += 3)
+	{
+		const Vector3& p0 = p_vertices[p_indices[i]];
+		const Vector3& p1 = p_vertices[p_indices[i + 1]];
+		const Vector3& p2 = p_vertices[p_indices[i + 2]];
+
+		Vector3 normal = (p1 - p0).cross(p2 - p0);
+		const double length = normal.length();
+		if (length <= 0.0)
+		{
+			continue;
+		}
+
+		const double a = normal.x / length;
+		const double b = normal.y / length;
+		const double c = normal.z / length;
+		const double d = -(a * p0.x + b * p0.y + c * p0.z);
+
+		Quadric plane{ a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+		quadrics[p_indices[i]].add(plane);
+		quadrics[p_indices[i + 1]].add(plane);
+		quadrics[p_indices[i + 2]].add(plane);
+	}
+}
+
+void MeshSimplifier::build_locks(const std::vector<Vector3>& p_vertices, const std::vector<uint32_t>& p_indices)
+{
+	locked.assign(p_vertices.size(), 0);
+
+	// Vertices on the chunk faces are shared with the neighbouring chunk's mesh
+	constexpr float epsilon = 0.001f;
+	constexpr float border = static_cast<float>(CHUNK_SIZE) - epsilon;
+	for (size_t i = 0; i < p_vertices.size(); ++i)
+	{
+		const Vector3& vertex = p_vertices[i];
+		if (vertex.x <= epsilon || vertex.y <= epsilon || vertex.z <= epsilon || vertex.x >= border || vertex.y >= border || vertex.z >= border)
+		{
+			locked[i] = 1;
+		}
+	}
+
+	// Edges used by a single triangle are holes in the mesh, collapsing them would make the hole bigger
+	edges.clear();
+	edges.reserve(p_indices.size());
+	for (size_t i = 0; i < p_indices.size(); i += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			uint64_t a = p_indices[i + e];
+			uint64_t b = p_indices[i + (e + 1) % 3];
+			edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t run_end = i + 1;
+		while (run_end < edges.size() && edges[run_end] == edges[i])
+		{
+			run_end++;
+		}
+		if (run_end - i == 1)
+		{
+			locked[edges[i] >> 32] = 1;
+			locked[edges[i] & 0xFFFFFFFFULL] = 1;
+		}
+		i = run_end;
+	}
+}
+
+void MeshSimplifier::build_adjacency(size_t p_vertex_count, const std::vector<uint32_t>& p_indices)
+{
+	adjacency_offsets.assign(p_vertex_count + 1, 0);
+	for (uint32_t index : p_indices)
+	{
+		adjacency_offsets[index + 1]++;
+	}
+	for (size_t i = 1; i <= p_vertex_count; ++i)
+	{
+		adjacency_offsets[i] += adjacency_offsets[i - 1];
+	}
+
+	adjacency.resize(p_indices.size());
+	// Use remap as the write cursor, it gets reset before use
+	remap.assign(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for (size_t i = 0; i < p_indices.size(); ++i)
+	{
+		adjacency[remap[p_indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+}
+
+bool MeshSimplifier::flips_triangle(const std::vector<Vector3>& p_vertices, const std::vector<uint32_t>& p_indices, uint32_t p_from, uint32_t p_to) const
+{
+	const Vector3& target = p_vertices[p_to];
+
+	for (uint32_t k = adjacency_offsets[p_from]; k < adjacency_offsets[p_from + 1]; ++k)
+	{
+		const uint32_t* triangle = &p_indices[adjacency[k] * 3];
+		if (triangle[0] == p_to || triangle[1] == p_to || triangle[2] == p_to)
+		{
+			continue; // Removed by the collapse
+		}
+
+		Vector3 p0 = p_vertices[triangle[0]];
+		Vector3 p1 = p_vertices[triangle[1]];
+		Vector3 p2 = p_vertices[triangle[2]];
+		Vector3 old_normal = (p1 - p0).cross(p2 - p0);
+
+		if (triangle[0] == p_from) p0 = target;
+		if (triangle[1] == p_from) p1 = target;
+		if (triangle[2] == p_from) p2 = target;
+		Vector3 new_normal = (p1 - p0).cross(p2 - p0);
+
+		constexpr float min_area_sqr = 1e-10f;
+		if (old_normal.dot(new_normal) <= 0.0f || new_normal.length_squared() < min_area_sqr)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace godot;
+
+/**
+ * @brief Quadric error metric mesh simplifier
+ * Collapses edges of an indexed triangle mesh until either the triangle budget is met or the next
+ * collapse would exceed the error bound. Vertices on the chunk border and on open edges are locked,
+ * so neighbouring chunks stay watertight.
+ * Not thread safe per instance, each worker thread should use its own.
+ */
+class MeshSimplifier
+{
+public:
+	// p_target_triangle_count <= 0 disables the budget, p_max_error <= 0 disables the error bound
+	// p_max_error is a distance in local units (1 unit = 1 voxel)
+	void simplify(std::vector<Vector3>& r_vertices, std::vector<uint32_t>& r_indices, int64_t p_target_triangle_count, float p_max_error);
+
+private:
+	// Symmetric 4x4 matrix, only the upper triangle is stored
+	struct Quadric
+	{
+		double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+		double b2 = 0.0, bc = 0.0, bd = 0.0;
+		double c2 = 0.0, cd = 0.0;
+		double d2 = 0.0;
+
+		void add(const Quadric& p_other);
+		double error(const Vector3& p_point) const;
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	void build_quadrics(const std::vector<Vector3>& p_vertices, const std::vector<uint32_t>& p_indices);
+	void build_locks(const std::vector<Vector3>& p_vertices, const std::vector<uint32_t>& p_indices);
+	void build_adjacency(size_t p_vertex_count, const std::vector<uint32_t>& p_indices);
+	bool flips_triangle(const std::vector<Vector3>& p_vertices, const std::vector<uint32_t>& p_indices, uint32_t p_from, uint32_t p_to) const;
+
+	// Scratch buffers are kept between calls to avoid re-allocating for every chunk
+	std::vector<Quadric> quadrics;
+	std::vector<uint8_t> locked;
+	std::vector<uint8_t> touched;
+	std::vector<uint32_t> remap;
+	std::vector<uint32_t> adjacency_offsets;
+	std::vector<uint32_t> adjacency;
+	std::vector<uint64_t> edges;
+	std::vector<Collapse> collapses;
+};
@@ -0,0 +1,113 @@
+#include "occupancy_grid.h"
+
+#include "chunk_shells.h"
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+using namespace godot;
+
+static_assert(OccupancyGrid::SIZE == 2 * chunk_shells::MAX_RADIUS + 1, "The grid has to fit the largest load radius");
+
+OccupancyGrid::OccupancyGrid() :
+		words(std::make_unique<std::atomic<uint64_t>[]>(WORD_COUNT))
+{
+	clear();
+}
+
+void OccupancyGrid::clear()
+{
+	for (int64_t i = 0; i < WORD_COUNT; ++i)
+	{
+		words[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+int32_t OccupancyGrid::wrap(int32_t p_value)
+{
+	const int32_t wrapped = p_value % SIZE;
+	return wrapped < 0 ? wrapped + SIZE : wrapped;
+}
+
+bool OccupancyGrid::test(const Vector3i& p_chunk_pos) const
+{
+	const int32_t x = wrap(p_chunk_pos.x);
+	const int64_t row = wrap(p_chunk_pos.y) + static_cast<int64_t>(wrap(p_chunk_pos.z)) * SIZE;
+	const uint64_t word = words[row * WORDS_PER_ROW + (x >> 6)].load(std::memory_order_acquire);
+	return (word >> (x & 63)) & 1;
+}
+
+void OccupancyGrid::set(const Vector3i& p_chunk_pos, bool p_value)
+{
+	const int32_t x = wrap(p_chunk_pos.x);
+	const int64_t row = wrap(p_chunk_pos.y) + static_cast<int64_t>(wrap(p_chunk_pos.z)) * SIZE;
+	const uint64_t mask = uint64_t(1) << (x & 63);
+	std::atomic<uint64_t>& word = words[row * WORDS_PER_ROW + (x >> 6)];
+	if (p_value)
+	{
+		word.fetch_or(mask, std::memory_order_release);
+	}
+	else
+	{
+		word.fetch_and(~mask, std::memory_order_release);
+	}
+}
+
+int64_t OccupancyGrid::count_set(int64_t p_row, int32_t p_begin, int32_t p_end) const
+{
+	int64_t count = 0;
+	for (int32_t word_index = p_begin >> 6; word_index <= (p_end - 1) >> 6; ++word_index)
+	{
+		const int32_t word_begin = word_index << 6;
+		const int32_t low = std::max(p_begin - word_begin, 0);
+		const int32_t high = std::min(p_end - word_begin, 64);
+
+		uint64_t mask = high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1;
+		mask &= ~((uint64_t(1) << low) - 1);
+
+		count += std::popcount(words[p_row * WORDS_PER_ROW + word_index].load(std::memory_order_acquire) & mask);
+	}
+	return count;
+}
+
+int64_t OccupancyGrid::count_missing(const Vector3i& p_centre, int32_t p_radius, int32_t p_vertical_scale) const
+{
+	const int64_t radius_sq = static_cast<int64_t>(p_radius) * p_radius;
+	const int32_t height = p_radius / p_vertical_scale;
+
+	int64_t missing = 0;
+	for (int32_t z = -p_radius; z <= p_radius; ++z)
+	{
+		for (int32_t y = -height; y <= height; ++y)
+		{
+			const int64_t scaled_y = static_cast<int64_t>(y) * p_vertical_scale;
+			const int64_t remaining_sq = radius_sq - scaled_y * scaled_y - static_cast<int64_t>(z) * z;
+			if (remaining_sq < 0)
+			{
+				continue;
+			}
+
+			// The row of the sphere is 2 * half_width + 1 long, it can wrap around the end of the grid
+			const int32_t half_width = static_cast<int32_t>(std::sqrt(static_cast<double>(remaining_sq)));
+			const int32_t length = 2 * half_width + 1;
+			const int32_t begin = wrap(p_centre.x - half_width);
+			const int64_t row = wrap(p_centre.y + y) + static_cast<int64_t>(wrap(p_centre.z + z)) * SIZE;
+
+			const int32_t first_end = std::min(begin + length, SIZE);
+			int64_t set_count = count_set(row, begin, first_end);
+			if (begin + length > SIZE)
+			{
+				set_count += count_set(row, 0, begin + length - SIZE);
+			}
+
+			missing += length - set_count;
+		}
+	}
+	return missing;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+using namespace godot;
+
+/**
+ * @brief Toroidal bit grid of the chunks around a centre that have been requested
+ * Covers a cube of 2 * chunk_shells::MAX_RADIUS + 1 chunks. A chunk's slot is its position wrapped into the cube, so moving the
+ * centre doesn't shift any bits, but a slot that wrapped around still holds the bit of the chunk that left.
+ * Positions entering the cube have to be set or cleared before they're tested, see ChunkInterest.
+ * The bits are atomic words so tests never lock.
+ */
+class OccupancyGrid
+{
+public:
+	static constexpr int32_t SIZE = 65;
+
+	OccupancyGrid();
+
+	void clear();
+
+	bool test(const Vector3i& p_chunk_pos) const;
+	void set(const Vector3i& p_chunk_pos, bool p_value = true);
+
+	// Chunks within p_radius of p_centre without a bit, counted a word at a time along the rows of the cube.
+	// The vertical axis is scaled like the chunk_shells shapes
+	int64_t count_missing(const Vector3i& p_centre, int32_t p_radius, int32_t p_vertical_scale = 1) const;
+
+private:
+	static constexpr int32_t WORDS_PER_ROW = 2; // 65 bits rounded up
+	static constexpr int64_t WORD_COUNT = static_cast<int64_t>(SIZE) * SIZE * WORDS_PER_ROW;
+
+	static int32_t wrap(int32_t p_value);
+	int64_t count_set(int64_t p_row, int32_t p_begin, int32_t p_end) const;
+
+	std::unique_ptr<std::atomic<uint64_t>[]> words;
+};
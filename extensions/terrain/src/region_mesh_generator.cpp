@@ -0,0 +1,74 @@
+#include "region_mesh_generator.h"
+
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/mesh.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/color.hpp>
+#include <godot_cpp/variant/packed_color_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace godot;
+
+RegionMeshData RegionMeshGenerator::process_task(RegionMeshTask task)
+{
+	RegionMeshData region_mesh_data{};
+	region_mesh_data.region_pos = task.region_pos;
+	region_mesh_data.level = task.level;
+	region_mesh_data.version = task.version;
+
+	int64_t vertex_count = 0;
+	for (const RegionMeshTask::Member& member : task.members)
+	{
+		vertex_count += PackedVector3Array(member.mesh_arrays[Mesh::ARRAY_VERTEX]).size();
+	}
+
+	if (vertex_count == 0)
+	{
+		return region_mesh_data;
+	}
+
+	PackedVector3Array vertices;
+	PackedVector3Array normals;
+	PackedColorArray colours;
+	vertices.resize(vertex_count);
+	normals.resize(vertex_count);
+	colours.resize(vertex_count);
+
+	Vector3* vertices_ptr = vertices.ptrw();
+	Vector3* normals_ptr = normals.ptrw();
+	Color* colours_ptr = colours.ptrw();
+
+	int64_t offset = 0;
+	for (const RegionMeshTask::Member& member : task.members)
+	{
+		const PackedVector3Array member_vertices = member.mesh_arrays[Mesh::ARRAY_VERTEX];
+		const PackedVector3Array member_normals = member.mesh_arrays[Mesh::ARRAY_NORMAL];
+		const PackedColorArray member_colours = member.mesh_arrays[Mesh::ARRAY_COLOR];
+
+		const int64_t count = member_vertices.size();
+		const Vector3* member_vertices_ptr = member_vertices.ptr();
+		for (int64_t i = 0; i < count; ++i)
+		{
+			vertices_ptr[offset + i] = member_vertices_ptr[i] + member.offset;
+		}
+		std::copy_n(member_normals.ptr(), count, normals_ptr + offset);
+		std::copy_n(member_colours.ptr(), count, colours_ptr + offset);
+
+		offset += count;
+	}
+
+	Array mesh_arrays{};
+	mesh_arrays.resize(Mesh::ARRAY_MAX);
+	mesh_arrays[Mesh::ARRAY_VERTEX] = vertices;
+	mesh_arrays[Mesh::ARRAY_NORMAL] = normals;
+	mesh_arrays[Mesh::ARRAY_COLOR] = colours;
+
+	region_mesh_data.array_mesh.instantiate();
+	region_mesh_data.array_mesh->add_surface_from_arrays(Mesh::PrimitiveType::PRIMITIVE_TRIANGLES, mesh_arrays);
+
+	return region_mesh_data;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "abstract_task_processer.h"
+
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/wrapped.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace godot;
+
+struct RegionMeshTask
+{
+	struct Member
+	{
+		Vector3 offset{}; // Chunk origin relative to the region origin
+		Array mesh_arrays;
+	};
+
+	Vector3i region_pos{};
+	int32_t level = 0;
+	uint32_t version = 0;
+	std::vector<Member> members{};
+};
+
+struct RegionMeshData
+{
+	Vector3i region_pos{};
+	int32_t level = 0;
+	uint32_t version = 0;
+	Ref<ArrayMesh> array_mesh; // Null when no member has any vertices
+};
+
+// Merges the mesh arrays of the chunks in a region into one mesh, so the region is a single draw call
+class RegionMeshGenerator final : public ITaskProcessor<RegionMeshTask, RegionMeshData>
+{
+	GDCLASS(RegionMeshGenerator, RefCounted)
+
+public:
+	RegionMeshGenerator() = default;
+	virtual ~RegionMeshGenerator() = default;
+
+	static Ref<RegionMeshGenerator> create()
+	{
+		Ref<RegionMeshGenerator> region_mesh_generator = memnew((RegionMeshGenerator));
+		return region_mesh_generator;
+	}
+
+	virtual RegionMeshData process_task(RegionMeshTask task) override;
+
+protected:
+	static void _bind_methods() {}
+};
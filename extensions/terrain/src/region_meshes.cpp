@@ -0,0 +1,327 @@
+#include "region_meshes.h"
+
+#include "mesh_generator.h"
+#include "region_mesh_generator.h"
+#include "terrain_constants.h"
+#include "terrain_math.h"
+
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/variant/basis.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace godot;
+using namespace terrain_constants;
+using namespace terrain_math;
+
+RegionMeshes::~RegionMeshes()
+{
+	clear();
+}
+
+void RegionMeshes::init(RID p_scenario, RID p_material, float p_near_distance, float p_far_distance, ChunkVisibilityFunc p_set_chunk_visible)
+{
+	scenario = p_scenario;
+	material = p_material;
+	near_distance = p_near_distance;
+	far_distance = p_far_distance;
+	chunk_visibility_func = std::move(p_set_chunk_visible);
+	has_viewer_chunk_pos = false;
+}
+
+void RegionMeshes::clear()
+{
+	for (auto& level_regions : regions)
+	{
+		for (auto& [region_pos, region] : level_regions)
+		{
+			free_instance(region);
+		}
+		level_regions.clear();
+	}
+
+	chunk_mesh_arrays.clear();
+	hidden_chunks.clear();
+	touched.clear();
+	has_viewer_chunk_pos = false;
+}
+
+void RegionMeshes::set_viewer_chunk_pos(const Vector3i& p_chunk_pos)
+{
+	if (has_viewer_chunk_pos && viewer_chunk_pos == p_chunk_pos)
+	{
+		return;
+	}
+
+	viewer_chunk_pos = p_chunk_pos;
+	has_viewer_chunk_pos = true;
+
+	// Every region's distance band may have changed
+	for (const auto& [region_pos, region] : regions[TOP_LEVEL])
+	{
+		touched.insert(region_pos);
+	}
+}
+
+void RegionMeshes::chunk_mesh_changed(const MeshData& p_mesh_data)
+{
+	const Vector3i chunk_pos = p_mesh_data.chunk_pos;
+	if (p_mesh_data.array_mesh.is_valid() && !p_mesh_data.mesh_arrays.is_empty())
+	{
+		chunk_mesh_arrays[chunk_pos] = p_mesh_data.mesh_arrays;
+	}
+	else
+	{
+		chunk_mesh_arrays.erase(chunk_pos);
+	}
+
+	// Applying the mesh showed the chunk again
+	hidden_chunks.erase(chunk_pos);
+
+	const bool has_mesh = chunk_mesh_arrays.contains(chunk_pos);
+	bool is_region_drawn = false;
+	for (int32_t level = 0; level < LEVEL_COUNT; ++level)
+	{
+		const Vector3i region_pos = floor_div(chunk_pos, get_region_size(level));
+		auto [it, is_new] = regions[level].try_emplace(region_pos);
+		Region& region = it->second;
+		region.version = ++next_region_version;
+		if (is_new)
+		{
+			region.first_version = region.version;
+		}
+
+		if (!has_mesh && !has_member_meshes(region_pos, level))
+		{
+			// Its last chunk left, builds still in flight are dropped by apply_result
+			free_instance(region);
+			regions[level].erase(it);
+			continue;
+		}
+
+		is_region_drawn |= region.is_drawn;
+	}
+
+	if (is_region_drawn)
+	{
+		// Stays hidden until the region is rebuilt rather than being drawn twice
+		set_chunk_visible(chunk_pos, false);
+	}
+
+	touched.insert(floor_div(chunk_pos, get_region_size(TOP_LEVEL)));
+}
+
+void RegionMeshes::apply_result(const RegionMeshData& p_region_mesh_data)
+{
+	if (p_region_mesh_data.level < 0 || p_region_mesh_data.level >= LEVEL_COUNT)
+	{
+		return;
+	}
+
+	auto it = regions[p_region_mesh_data.level].find(p_region_mesh_data.region_pos);
+	if (it == regions[p_region_mesh_data.level].end())
+	{
+		return; // Cleared while building
+	}
+
+	Region& region = it->second;
+	if (p_region_mesh_data.version < region.first_version)
+	{
+		return; // Built before the region was emptied and made again
+	}
+
+	// An outdated mesh is still used, it is closer than the previous one and the region stays marked for a rebuild
+	region.is_building = false;
+	region.is_built = true;
+	region.built_version = p_region_mesh_data.version;
+	region.array_mesh = p_region_mesh_data.array_mesh;
+	update_instance(region, p_region_mesh_data.region_pos, p_region_mesh_data.level);
+
+	const int32_t top_level_scale = get_region_size(TOP_LEVEL) / get_region_size(p_region_mesh_data.level);
+	touched.insert(floor_div(p_region_mesh_data.region_pos, top_level_scale));
+}
+
+void RegionMeshes::update_next(std::vector<RegionMeshTask>& r_tasks)
+{
+	if (touched.empty())
+	{
+		return;
+	}
+
+	const Vector3i top_pos = *touched.begin();
+	touched.erase(touched.begin());
+
+	auto top_it = regions[TOP_LEVEL].find(top_pos);
+	if (top_it == regions[TOP_LEVEL].end())
+	{
+		return;
+	}
+
+	Region& top_region = top_it->second;
+	const bool is_top_wanted = get_viewer_distance(top_pos, TOP_LEVEL) > far_distance;
+	if (is_top_wanted && top_region.needs_build())
+	{
+		queue_build(top_region, top_pos, TOP_LEVEL, r_tasks);
+	}
+
+	const bool is_top_drawn = is_top_wanted && top_region.is_built;
+	set_region_drawn(top_region, top_pos, TOP_LEVEL, is_top_drawn);
+
+	for (int32_t i = 0; i < 8; ++i)
+	{
+		const Vector3i child_pos = top_pos * 2 + Vector3i(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+		auto child_it = regions[0].find(child_pos);
+		if (child_it == regions[0].end())
+		{
+			continue;
+		}
+
+		Region& child_region = child_it->second;
+		const bool is_child_wanted = !is_top_wanted && get_viewer_distance(child_pos, 0) > near_distance;
+		if (is_child_wanted && child_region.needs_build())
+		{
+			queue_build(child_region, child_pos, 0, r_tasks);
+		}
+
+		const bool is_child_drawn = !is_top_drawn && is_child_wanted && child_region.is_built;
+		set_region_drawn(child_region, child_pos, 0, is_child_drawn);
+
+		for (int32_t j = 0; j < 8; ++j)
+		{
+			const Vector3i chunk_pos = child_pos * 2 + Vector3i(j & 1, (j >> 1) & 1, (j >> 2) & 1);
+			if (chunk_mesh_arrays.contains(chunk_pos))
+			{
+				set_chunk_visible(chunk_pos, !is_top_drawn && !is_child_drawn);
+			}
+		}
+	}
+}
+
+float RegionMeshes::get_viewer_distance(const Vector3i& p_region_pos, int32_t p_level) const
+{
+	const float region_size = get_region_size(p_level);
+	const Vector3 region_centre = (Vector3(p_region_pos) + Vector3(0.5f, 0.5f, 0.5f)) * region_size;
+	const Vector3 viewer_centre = Vector3(viewer_chunk_pos) + Vector3(0.5f, 0.5f, 0.5f);
+	return region_centre.distance_to(viewer_centre);
+}
+
+void RegionMeshes::queue_build(Region& p_region, const Vector3i& p_region_pos, int32_t p_level, std::vector<RegionMeshTask>& r_tasks)
+{
+	const int32_t region_size = get_region_size(p_level);
+	const Vector3i origin_chunk_pos = p_region_pos * region_size;
+
+	RegionMeshTask task{};
+	task.region_pos = p_region_pos;
+	task.level = p_level;
+	task.version = p_region.version;
+
+	for (int32_t z = 0; z < region_size; ++z)
+	{
+		for (int32_t y = 0; y < region_size; ++y)
+		{
+			for (int32_t x = 0; x < region_size; ++x)
+			{
+				const Vector3i offset(x, y, z);
+				auto it = chunk_mesh_arrays.find(origin_chunk_pos + offset);
+				if (it != chunk_mesh_arrays.end())
+				{
+					task.members.push_back({ Vector3(offset * CHUNK_SIZE), it->second });
+				}
+			}
+		}
+	}
+
+	p_region.is_building = true;
+	r_tasks.push_back(std::move(task));
+}
+
+bool RegionMeshes::has_member_meshes(const Vector3i& p_region_pos, int32_t p_level) const
+{
+	const int32_t region_size = get_region_size(p_level);
+	const Vector3i origin_chunk_pos = p_region_pos * region_size;
+	for (int32_t z = 0; z < region_size; ++z)
+	{
+		for (int32_t y = 0; y < region_size; ++y)
+		{
+			for (int32_t x = 0; x < region_size; ++x)
+			{
+				if (chunk_mesh_arrays.contains(origin_chunk_pos + Vector3i(x, y, z)))
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void RegionMeshes::free_instance(Region& p_region)
+{
+	RenderingServer* rendering_server = RenderingServer::get_singleton();
+	if (p_region.instance.is_valid() && rendering_server)
+	{
+		rendering_server->free_rid(p_region.instance);
+	}
+	p_region.instance = RID();
+}
+
+void RegionMeshes::set_region_drawn(Region& p_region, const Vector3i& p_region_pos, int32_t p_level, bool p_is_drawn)
+{
+	if (p_region.is_drawn == p_is_drawn)
+	{
+		return;
+	}
+
+	p_region.is_drawn = p_is_drawn;
+	update_instance(p_region, p_region_pos, p_level);
+}
+
+void RegionMeshes::update_instance(Region& p_region, const Vector3i& p_region_pos, int32_t p_level)
+{
+	RenderingServer* rendering_server = RenderingServer::get_singleton();
+
+	if (!p_region.instance.is_valid())
+	{
+		if (!p_region.is_drawn || p_region.array_mesh.is_null())
+		{
+			return; // Nothing to draw yet
+		}
+
+		p_region.instance = rendering_server->instance_create();
+		rendering_server->instance_set_scenario(p_region.instance, scenario);
+		rendering_server->instance_set_transform(p_region.instance, Transform3D(Basis(), Vector3(p_region_pos * get_region_size(p_level) * CHUNK_SIZE)));
+		rendering_server->instance_geometry_set_material_override(p_region.instance, material);
+	}
+
+	rendering_server->instance_set_base(p_region.instance, p_region.array_mesh.is_valid() ? p_region.array_mesh->get_rid() : RID());
+	rendering_server->instance_set_visible(p_region.instance, p_region.is_drawn);
+}
+
+void RegionMeshes::set_chunk_visible(const Vector3i& p_chunk_pos, bool p_visible)
+{
+	const bool is_hidden = hidden_chunks.contains(p_chunk_pos);
+	if (is_hidden != p_visible)
+	{
+		return; // Already in that state
+	}
+
+	if (p_visible)
+	{
+		hidden_chunks.erase(p_chunk_pos);
+	}
+	else
+	{
+		hidden_chunks.insert(p_chunk_pos);
+	}
+
+	if (chunk_visibility_func)
+	{
+		chunk_visibility_func(p_chunk_pos, p_visible);
+	}
+}
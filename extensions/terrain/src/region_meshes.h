@@ -0,0 +1,93 @@
+#pragma once
+
+#include "concurrent_chunk_map.h"
+#include "mesh_generator.h"
+#include "region_mesh_generator.h"
+
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace godot;
+
+/**
+ * @brief Batches distant chunks into region meshes, so each region is one instance and one draw call
+ * Past near_distance chunks are drawn in 2x2x2 regions, past far_distance in 4x4x4 regions (distances in chunks).
+ * A region is only drawn once its merged mesh is built, its member chunks are hidden while it is drawn.
+ * When a member chunk changes only the regions containing it are rebuilt, a region is erased once its last chunk is unloaded.
+ * Main thread only, the merging is done on worker threads by RegionMeshGenerator.
+ */
+class RegionMeshes
+{
+public:
+	using ChunkVisibilityFunc = std::function<void(const Vector3i&, bool)>;
+
+	~RegionMeshes();
+
+	void init(RID p_scenario, RID p_material, float p_near_distance, float p_far_distance, ChunkVisibilityFunc p_set_chunk_visible);
+	// Frees every RID, hidden chunks aren't shown again
+	void clear();
+
+	void set_viewer_chunk_pos(const Vector3i& p_chunk_pos);
+	void chunk_mesh_changed(const MeshData& p_mesh_data);
+	void apply_result(const RegionMeshData& p_region_mesh_data);
+
+	bool has_pending_updates() const { return !touched.empty(); }
+	// True while the chunk is hidden because a region draws it
+	bool is_chunk_hidden(const Vector3i& p_chunk_pos) const { return hidden_chunks.contains(p_chunk_pos); }
+	// Updates the draw state of one of the 4x4x4 regions that changed, adding any builds it needs to r_tasks
+	void update_next(std::vector<RegionMeshTask>& r_tasks);
+
+private:
+	struct Region
+	{
+		RID instance;
+		Ref<ArrayMesh> array_mesh;
+		uint32_t version = 0; // Bumped when a member chunk changes
+		uint32_t first_version = 0; // Results older than this were built for a region erased at this position
+		uint32_t built_version = 0;
+		bool is_built = false;
+		bool is_building = false;
+		bool is_drawn = false;
+
+		bool needs_build() const { return !is_building && (!is_built || built_version != version); }
+	};
+
+	// Level 0 regions are 2x2x2 chunks, level 1 regions are 4x4x4 chunks and contain 8 level 0 regions
+	static constexpr int32_t LEVEL_COUNT = 2;
+	static constexpr int32_t TOP_LEVEL = LEVEL_COUNT - 1;
+	static constexpr int32_t get_region_size(int32_t p_level) { return 2 << p_level; }
+
+	float get_viewer_distance(const Vector3i& p_region_pos, int32_t p_level) const;
+	bool has_member_meshes(const Vector3i& p_region_pos, int32_t p_level) const;
+	void free_instance(Region& p_region);
+	void queue_build(Region& p_region, const Vector3i& p_region_pos, int32_t p_level, std::vector<RegionMeshTask>& r_tasks);
+	void set_region_drawn(Region& p_region, const Vector3i& p_region_pos, int32_t p_level, bool p_is_drawn);
+	void update_instance(Region& p_region, const Vector3i& p_region_pos, int32_t p_level);
+	void set_chunk_visible(const Vector3i& p_chunk_pos, bool p_visible);
+
+	using ChunkSet = std::unordered_set<Vector3i, Vector3iHasher>;
+
+	std::unordered_map<Vector3i, Array, Vector3iHasher> chunk_mesh_arrays{};
+	std::unordered_map<Vector3i, Region, Vector3iHasher> regions[LEVEL_COUNT]{};
+	ChunkSet hidden_chunks{};
+	ChunkSet touched{}; // Top level regions to update
+	uint32_t next_region_version = 0; // Shared by every region so a region made again never reuses a version
+
+	Vector3i viewer_chunk_pos{};
+	bool has_viewer_chunk_pos = false;
+
+	RID scenario;
+	RID material;
+	float near_distance = 4.0f;
+	float far_distance = 12.0f;
+	ChunkVisibilityFunc chunk_visibility_func;
+};
@@ -6,6 +6,7 @@
 #include "chunk_viewer.h"
 #include "collision_generator.h"
 #include "mesh_generator.h"
+#include "region_mesh_generator.h"
 #include "terrain_performance_monitor.h"
 #include "thread_pool.h"
 
@@ -40,6 +41,7 @@ void initialize_gdextension_types(ModuleInitializationLevel p_level)
 	GDREGISTER_CLASS(ChunkViewer)
 	GDREGISTER_CLASS(CollisionGenerator)
 	GDREGISTER_CLASS(MeshGenerator)
+	GDREGISTER_CLASS(RegionMeshGenerator)
 	GDREGISTER_CLASS(ThreadPoolBase)
 }
 
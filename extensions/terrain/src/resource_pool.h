@@ -0,0 +1,72 @@
+#pragma once
+
+#include <godot_cpp/classes/ref.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A thread safe recycle pool for RefCounted resources, e.g. ArrayMesh and ConcavePolygonShape3D
+ * Like SafePool, but for Ref<T>. A resource is only taken back when the caller holds the last reference,
+ * anything still referenced elsewhere (a MeshInstance3D, a queued task) is just dropped, so a recycled
+ * resource is never shared. Recycled resources keep their RIDs, callers reset the contents.
+ */
+template <typename T>
+class ResourcePool
+{
+public:
+	explicit ResourcePool(size_t p_capacity = 1024) :
+			capacity(p_capacity) {}
+
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	godot::Ref<T> acquire()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!pool.empty())
+			{
+				godot::Ref<T> resource = std::move(pool.back());
+				pool.pop_back();
+				return resource;
+			}
+		}
+
+		godot::Ref<T> resource;
+		resource.instantiate();
+		return resource;
+	}
+
+	// Always leaves r_resource null
+	void release(godot::Ref<T>& r_resource)
+	{
+		if (r_resource.is_null())
+		{
+			return;
+		}
+
+		if (r_resource->get_reference_count() == 1)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (pool.size() < capacity)
+			{
+				pool.push_back(std::move(r_resource));
+			}
+		}
+		r_resource.unref();
+	}
+
+	// Size of values available in the pool
+	uint64_t size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return pool.size();
+	}
+
+private:
+	std::vector<godot::Ref<T>> pool;
+	size_t capacity;
+	mutable std::mutex mutex;
+};
@@ -1,16 +1,27 @@
 #pragma once
 
+#include "virtual_arena.h"
+
+#include <godot_cpp/core/memory.hpp>
+
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <vector>
-#include <godot_cpp/core/memory.hpp>
 
 /**
  * @brief A thread safe object pool
  * Uses RAII-based automatic recycling:
  * when a 'SafePool::Ptr' goes out of scope, the object is automatically
  * returned to the pool rather than being deleted.
+ * Every acquire and release locks, callers taking or giving back many objects use acquire_many and release_many to
+ * lock once.
+ * Ptrs must not outlive their pool, the deleter holds a plain pointer so releasing does no reference counting.
+ * The objects live in a VirtualArena reserved for max_count of them, a block of them is only committed when the pool
+ * runs out, so a pool that's never used costs address space and nothing else. Objects never move.
+ * trim decommits blocks whose objects are all back in the pool. If the arena fills up, blocks come from the heap.
  */
 template <typename T>
 class SafePool : public std::enable_shared_from_this<SafePool<T>>
@@ -19,15 +30,33 @@ private:
 	// Logic for when a pointer "dies"
 	struct PoolDeleter
 	{
-		std::weak_ptr<SafePool<T>> weak_pool;
+		SafePool<T>* pool = nullptr;
 		void operator()(T* ptr) const
 		{
-			if (auto strong_pool = weak_pool.lock()) strong_pool->release(ptr);
+			if (pool) pool->release(ptr);
 		}
 	};
 
-	SafePool(int32_t p_block_size) :
-			block_size(p_block_size) {}
+	SafePool(uint64_t p_block_size, uint64_t p_max_count, bool p_use_huge_pages)
+	{
+		block_size = std::max<uint64_t>(p_block_size, 1);
+		const uint64_t alignment = p_use_huge_pages ? VirtualArena::HUGE_PAGE_SIZE : VirtualArena::get_page_size();
+		block_stride = (block_size * sizeof(T) + alignment - 1) / alignment * alignment;
+		block_size = block_stride / sizeof(T); // Fill the rounded up stride
+
+		const uint64_t block_count = (p_max_count + block_size - 1) / block_size;
+		arena = VirtualArena(block_count * block_stride, p_use_huge_pages ? alignment : 0);
+		if (!arena.is_valid())
+		{
+			return; // Every block comes from the heap
+		}
+		if (p_use_huge_pages)
+		{
+			arena.advise_huge_pages();
+		}
+		block_free_counts.resize(block_count, 0);
+		block_committed.resize(block_count, 0);
+	}
 
 public:
 	SafePool(const SafePool&) = delete;
@@ -36,20 +65,27 @@ public:
 	~SafePool()
 	{
 		std::lock_guard<std::mutex> lock(mutex);
-		for (T* block : blocks)
+		for (uint64_t block_index = 0; block_index < block_committed.size(); ++block_index)
+		{
+			if (block_committed[block_index])
+			{
+				std::destroy_n(get_block(block_index), block_size);
+			}
+		}
+		for (T* block : heap_blocks)
 		{
 			godot::memdelete_arr(block);
 		}
-		blocks.clear();
+		heap_blocks.clear();
 		pool.clear();
 	}
 
-	// Create the pool with a shared pointer so the deleter can return to it
-	static std::shared_ptr<SafePool<T>> create(size_t p_block_size = 4096)
+	// Create the pool with a shared pointer.
+	// p_block_size objects are committed at a time, rounded up to fill whole pages (or 2MB huge pages).
+	// Nothing is committed until the first acquire
+	static std::shared_ptr<SafePool<T>> create(uint64_t p_block_size = 64, uint64_t p_max_count = 1 << 16, bool p_use_huge_pages = false)
 	{
-		auto self = std::shared_ptr<SafePool<T>>(new SafePool<T>(p_block_size));
-		self->grow();
-		return self;
+		return std::shared_ptr<SafePool<T>>(new SafePool<T>(p_block_size, p_max_count, p_use_huge_pages));
 	}
 
 	// Define a pointer that returns to the pool instead of deleting
@@ -63,47 +99,200 @@ public:
 
 		T* raw_ptr = pool.back();
 		pool.pop_back();
+		const int64_t block_index = get_block_index(raw_ptr);
+		if (block_index >= 0)
+		{
+			--block_free_counts[block_index];
+		}
 
 		// Make this pointer return to the pool instead of deleting
-		return Ptr(raw_ptr, PoolDeleter{ this->shared_from_this() });
+		return Ptr(raw_ptr, PoolDeleter{ this });
+	}
+
+	// Takes p_count objects under one lock, they're owned by the caller until they're given back with release
+	void acquire_many(int64_t p_count, std::vector<T*>& r_ptrs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		take_locked(static_cast<uint64_t>(p_count), r_ptrs);
 	}
 
+	// Returns an object taken out of a Ptr with Ptr::release(), for owners that keep raw pointers
+	void release(T* ptr)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		give_locked(&ptr, &ptr + 1);
+	}
+
+	void release_many(const std::vector<T*>& p_ptrs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		give_locked(p_ptrs.begin(), p_ptrs.end());
+	}
+
+	// Commits blocks until there are at least count objects, for callers that know their peak up front
 	void pre_alocate(int32_t count)
 	{
 		std::lock_guard<std::mutex> lock(mutex);
-		int32_t new_block_count = (count / block_size) + 1 - blocks.size();
-		for (int32_t i = 0; i < new_block_count; i++)
+		while (capacity < static_cast<uint64_t>(count))
 		{
 			grow();
 		}
 	}
 
+	// Decommits arena blocks whose objects are all in the pool, leaving at least p_keep_free objects in it.
+	// Objects still acquired keep their block committed. The highest blocks go first
+	void trim(uint64_t p_keep_free)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pool.size() <= p_keep_free)
+		{
+			return;
+		}
+
+		uint64_t excess = pool.size() - p_keep_free;
+		std::vector<uint8_t> is_trimmed(block_committed.size(), 0);
+		bool any_trimmed = false;
+		for (uint64_t block_index = block_committed.size(); block_index-- > 0 && excess >= block_size;)
+		{
+			if (block_committed[block_index] && block_free_counts[block_index] == block_size)
+			{
+				is_trimmed[block_index] = 1;
+				any_trimmed = true;
+				excess -= block_size;
+			}
+		}
+		if (!any_trimmed)
+		{
+			return;
+		}
+
+		std::erase_if(pool, [&](T* p_ptr)
+				{
+					const int64_t block_index = get_block_index(p_ptr);
+					return block_index >= 0 && is_trimmed[block_index];
+				});
+		for (uint64_t block_index = 0; block_index < is_trimmed.size(); ++block_index)
+		{
+			if (is_trimmed[block_index])
+			{
+				std::destroy_n(get_block(block_index), block_size);
+				arena.decommit(block_index * block_stride, block_stride);
+				block_committed[block_index] = 0;
+				block_free_counts[block_index] = 0;
+				capacity -= block_size;
+			}
+		}
+	}
+
 	// Size of values available in the pool
-	uint64_t size() const { return pool.size(); }
+	uint64_t size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return pool.size();
+	}
+
+	// Objects that exist, committed in the arena or on the heap, acquired or not
+	uint64_t get_capacity() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return capacity;
+	}
 
 private:
-	void grow()
+	T* get_block(uint64_t p_block_index) const
 	{
-		T* new_block = godot::memnew_arr_template<T>(block_size);
-		blocks.emplace_back(new_block);
+		return reinterpret_cast<T*>(arena.get_base() + p_block_index * block_stride);
+	}
 
-		pool.reserve(pool.size() + block_size);
-		for (int32_t i = 0; i < block_size; ++i)
+	// -1 for objects in heap blocks
+	int64_t get_block_index(const T* p_ptr) const
+	{
+		if (!arena.contains(p_ptr))
 		{
-			pool.push_back(&new_block[i]);
+			return -1;
 		}
+		return static_cast<int64_t>((reinterpret_cast<const uint8_t*>(p_ptr) - arena.get_base()) / block_stride);
 	}
 
-	void release(T* ptr)
+	// Moves p_count objects from the pool to r_ptrs, growing it first if it's short
+	void take_locked(uint64_t p_count, std::vector<T*>& r_ptrs)
 	{
-		std::lock_guard<std::mutex> lock(mutex);
-		pool.push_back(ptr);
+		while (pool.size() < p_count)
+		{
+			grow();
+		}
+
+		for (auto it = pool.end() - p_count; it != pool.end(); ++it)
+		{
+			const int64_t block_index = get_block_index(*it);
+			if (block_index >= 0)
+			{
+				--block_free_counts[block_index];
+			}
+		}
+		r_ptrs.insert(r_ptrs.end(), pool.end() - p_count, pool.end());
+		pool.resize(pool.size() - p_count);
+	}
+
+	template <typename It>
+	void give_locked(It p_begin, It p_end)
+	{
+		for (It it = p_begin; it != p_end; ++it)
+		{
+			const int64_t block_index = get_block_index(*it);
+			if (block_index >= 0)
+			{
+				++block_free_counts[block_index];
+			}
+		}
+		pool.insert(pool.end(), p_begin, p_end);
+	}
+
+	// Commits the lowest uncommitted block, trimmed ones get reused before the arena is extended
+	void grow()
+	{
+		pool.reserve(pool.size() + block_size);
+		capacity += block_size;
+
+		for (uint64_t block_index = 0; block_index < block_committed.size(); ++block_index)
+		{
+			if (block_committed[block_index])
+			{
+				continue;
+			}
+			if (!arena.commit(block_index * block_stride, block_stride))
+			{
+				break;
+			}
+
+			T* block = get_block(block_index);
+			for (uint64_t i = 0; i < block_size; ++i)
+			{
+				pool.push_back(new (&block[i]) T);
+			}
+			block_committed[block_index] = 1;
+			block_free_counts[block_index] = static_cast<uint32_t>(block_size);
+			return;
+		}
+
+		// The arena is full, or couldn't be reserved or committed
+		T* new_block = godot::memnew_arr_template<T>(block_size);
+		heap_blocks.push_back(new_block);
+		for (uint64_t i = 0; i < block_size; ++i)
+		{
+			pool.push_back(&new_block[i]);
+		}
 	}
 
 	std::vector<T*> pool;
-	int32_t block_size;
-	std::vector<T*> blocks;
 	mutable std::mutex mutex;
 
-	// The data is stored in large contiguous blocks of memory, for pointer stability, and fast deletion
+	// The data is stored in blocks of contiguous memory, for pointer stability, and fast deletion
+	VirtualArena arena;
+	uint64_t block_size = 0; // Objects per block
+	uint64_t block_stride = 0; // Bytes from one arena block to the next, whole pages
+	uint64_t capacity = 0;
+	std::vector<uint32_t> block_free_counts; // Per arena block, how many of its objects are in the pool
+	std::vector<uint8_t> block_committed;
+	std::vector<T*> heap_blocks;
 };
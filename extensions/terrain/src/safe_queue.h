@@ -27,13 +27,13 @@ public:
 	{
 		mutex->lock();
 		std::deque<T>& target_queue = prioritise ? priority_queue : queue;
-		target_queue.push_back(value);
+		target_queue.push_back(std::move(value));
 		mutex->unlock();
 
 		semaphore->post();
 	}
 
-	void push(const std::vector<T>& values, bool prioritise = false)
+	void push(std::vector<T> values, bool prioritise = false)
 	{
 		if (values.empty()) return;
 		const uint32_t count = static_cast<uint32_t>(values.size());
@@ -137,6 +137,30 @@ public:
 		return empty;
 	}
 
+	// Removes the values matching p_predicate. Each takes its semaphore token with it, values whose token a thread
+	// already took are kept so that thread doesn't wake to an empty queue. Returns how many were removed
+	template <typename TPredicate>
+	uint64_t erase_if(TPredicate p_predicate)
+	{
+		mutex->lock();
+
+		uint64_t erased_count = 0;
+		auto is_erased = [&](const T& value)
+		{
+			if (p_predicate(value) && semaphore->try_wait())
+			{
+				++erased_count;
+				return true;
+			}
+			return false;
+		};
+		std::erase_if(priority_queue, is_erased);
+		std::erase_if(queue, is_erased);
+
+		mutex->unlock();
+		return erased_count;
+	}
+
 	void clear()
 	{
 		mutex->lock();
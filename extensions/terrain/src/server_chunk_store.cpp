@@ -0,0 +1,235 @@
+#include "server_chunk_store.h"
+
+#include "collision_generator.h"
+#include "mesh_generator.h"
+#include "terrain_constants.h"
+
+#include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/variant/basis.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace godot;
+using namespace terrain_constants;
+
+static Transform3D get_chunk_transform(const Vector3i& p_chunk_pos)
+{
+	return Transform3D(Basis(), Vector3(p_chunk_pos * CHUNK_SIZE));
+}
+
+ServerChunkStore::~ServerChunkStore()
+{
+	clear();
+}
+
+void ServerChunkStore::init(RID p_scenario, RID p_space, RID p_material)
+{
+	scenario = p_scenario;
+	space = p_space;
+	material = p_material;
+}
+
+void ServerChunkStore::clear()
+{
+	for (Slot& slot : slots)
+	{
+		free_slot_rids(slot);
+	}
+	slots.clear();
+	free_slots.clear();
+	slot_indices.clear();
+}
+
+void ServerChunkStore::update_chunk_mesh(const MeshData& p_mesh_data)
+{
+	RenderingServer* rendering_server = RenderingServer::get_singleton();
+	Slot& slot = slots[get_or_create_slot(p_mesh_data.chunk_pos)];
+
+	slot.mesh = p_mesh_data.array_mesh;
+	if (slot.mesh.is_null())
+	{
+		if (slot.instance.is_valid())
+		{
+			rendering_server->instance_set_base(slot.instance, RID());
+		}
+		return;
+	}
+
+	if (!slot.instance.is_valid())
+	{
+		slot.instance = rendering_server->instance_create();
+		rendering_server->instance_set_scenario(slot.instance, scenario);
+		rendering_server->instance_set_transform(slot.instance, get_chunk_transform(slot.chunk_pos));
+		rendering_server->instance_geometry_set_material_override(slot.instance, material);
+	}
+	rendering_server->instance_set_base(slot.instance, slot.mesh->get_rid());
+	rendering_server->instance_set_visible(slot.instance, true);
+}
+
+void ServerChunkStore::update_chunk_collision(const CollisionData& p_collision_data)
+{
+	PhysicsServer3D* physics_server = PhysicsServer3D::get_singleton();
+	Slot& slot = slots[get_or_create_slot(p_collision_data.chunk_pos)];
+
+	slot.shape = p_collision_data.collision_shape;
+	if (slot.shape.is_null())
+	{
+		if (slot.body.is_valid())
+		{
+			physics_server->body_clear_shapes(slot.body);
+		}
+		return;
+	}
+
+	if (!slot.body.is_valid())
+	{
+		slot.body = physics_server->body_create();
+		physics_server->body_set_mode(slot.body, PhysicsServer3D::BODY_MODE_STATIC);
+		physics_server->body_set_state(slot.body, PhysicsServer3D::BODY_STATE_TRANSFORM, get_chunk_transform(slot.chunk_pos));
+		physics_server->body_set_space(slot.body, space);
+	}
+
+	// Swap the shape on the body, it stays in the space
+	if (physics_server->body_get_shape_count(slot.body) > 0)
+	{
+		physics_server->body_set_shape(slot.body, 0, slot.shape->get_rid());
+	}
+	else
+	{
+		physics_server->body_add_shape(slot.body, slot.shape->get_rid());
+	}
+}
+
+void ServerChunkStore::set_visible(const Vector3i& p_chunk_pos, bool p_visible)
+{
+	const Slot* slot = find_slot(p_chunk_pos);
+	if (slot && slot->instance.is_valid())
+	{
+		RenderingServer::get_singleton()->instance_set_visible(slot->instance, p_visible);
+	}
+}
+
+void ServerChunkStore::release_slot(const Vector3i& p_chunk_pos, Ref<ArrayMesh>& r_mesh, Ref<ConcavePolygonShape3D>& r_shape)
+{
+	auto it = slot_indices.find(p_chunk_pos);
+	if (it == slot_indices.end())
+	{
+		return;
+	}
+
+	Slot& slot = slots[it->second];
+	if (slot.instance.is_valid())
+	{
+		RenderingServer::get_singleton()->instance_set_base(slot.instance, RID());
+	}
+	if (slot.body.is_valid())
+	{
+		PhysicsServer3D::get_singleton()->body_clear_shapes(slot.body);
+	}
+
+	r_mesh = slot.mesh;
+	r_shape = slot.shape;
+	slot.mesh.unref();
+	slot.shape.unref();
+
+	free_slots.push_back(it->second);
+	slot_indices.erase(it);
+}
+
+Ref<ArrayMesh> ServerChunkStore::get_mesh(const Vector3i& p_chunk_pos) const
+{
+	const Slot* slot = find_slot(p_chunk_pos);
+	return slot ? slot->mesh : Ref<ArrayMesh>();
+}
+
+Ref<ConcavePolygonShape3D> ServerChunkStore::get_collision_shape(const Vector3i& p_chunk_pos) const
+{
+	const Slot* slot = find_slot(p_chunk_pos);
+	return slot ? slot->shape : Ref<ConcavePolygonShape3D>();
+}
+
+bool ServerChunkStore::has_collision(const Vector3i& p_chunk_pos) const
+{
+	const Slot* slot = find_slot(p_chunk_pos);
+	return slot && slot->shape.is_valid();
+}
+
+void ServerChunkStore::get_chunk_positions(std::vector<Vector3i>& r_chunk_positions) const
+{
+	for (const auto& [chunk_pos, index] : slot_indices)
+	{
+		r_chunk_positions.push_back(chunk_pos);
+	}
+}
+
+uint32_t ServerChunkStore::get_or_create_slot(const Vector3i& p_chunk_pos)
+{
+	auto it = slot_indices.find(p_chunk_pos);
+	if (it != slot_indices.end())
+	{
+		return it->second;
+	}
+
+	uint32_t index;
+	if (!free_slots.empty())
+	{
+		index = free_slots.back();
+		free_slots.pop_back();
+
+		// Move the kept RIDs to the new position
+		const Slot& slot = slots[index];
+		if (slot.instance.is_valid())
+		{
+			RenderingServer::get_singleton()->instance_set_transform(slot.instance, get_chunk_transform(p_chunk_pos));
+		}
+		if (slot.body.is_valid())
+		{
+			PhysicsServer3D::get_singleton()->body_set_state(slot.body, PhysicsServer3D::BODY_STATE_TRANSFORM, get_chunk_transform(p_chunk_pos));
+		}
+	}
+	else
+	{
+		index = static_cast<uint32_t>(slots.size());
+		slots.emplace_back();
+	}
+
+	slots[index].chunk_pos = p_chunk_pos;
+	slot_indices[p_chunk_pos] = index;
+	return index;
+}
+
+const ServerChunkStore::Slot* ServerChunkStore::find_slot(const Vector3i& p_chunk_pos) const
+{
+	auto it = slot_indices.find(p_chunk_pos);
+	return it != slot_indices.end() ? &slots[it->second] : nullptr;
+}
+
+void ServerChunkStore::free_slot_rids(Slot& p_slot)
+{
+	if (p_slot.instance.is_valid())
+	{
+		if (RenderingServer* rendering_server = RenderingServer::get_singleton())
+		{
+			rendering_server->free_rid(p_slot.instance);
+		}
+		p_slot.instance = RID();
+	}
+
+	if (p_slot.body.is_valid())
+	{
+		if (PhysicsServer3D* physics_server = PhysicsServer3D::get_singleton())
+		{
+			physics_server->free_rid(p_slot.body);
+		}
+		p_slot.body = RID();
+	}
+
+	p_slot.mesh.unref();
+	p_slot.shape.unref();
+}
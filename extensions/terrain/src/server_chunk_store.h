@@ -0,0 +1,71 @@
+#pragma once
+
+#include "collision_generator.h"
+#include "concurrent_chunk_map.h"
+#include "mesh_generator.h"
+
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/concave_polygon_shape3d.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace godot;
+
+/**
+ * @brief Draws and collides chunks with RenderingServer and PhysicsServer3D RIDs directly, without scene nodes
+ * All per-chunk state lives in a flat array of slots, freed slots are re-used.
+ * Only used from the main thread.
+ */
+class ServerChunkStore
+{
+public:
+	~ServerChunkStore();
+
+	void init(RID p_scenario, RID p_space, RID p_material);
+	// Frees every RID
+	void clear();
+
+	void update_chunk_mesh(const MeshData& p_mesh_data);
+	void update_chunk_collision(const CollisionData& p_collision_data);
+	void set_visible(const Vector3i& p_chunk_pos, bool p_visible);
+
+	// Frees the slot for re-use, its RIDs are kept. The mesh and shape are handed back so they can be recycled
+	void release_slot(const Vector3i& p_chunk_pos, Ref<ArrayMesh>& r_mesh, Ref<ConcavePolygonShape3D>& r_shape);
+
+	Ref<ArrayMesh> get_mesh(const Vector3i& p_chunk_pos) const;
+	Ref<ConcavePolygonShape3D> get_collision_shape(const Vector3i& p_chunk_pos) const;
+	bool has_collision(const Vector3i& p_chunk_pos) const;
+
+	// Appends the position of every chunk with a slot
+	void get_chunk_positions(std::vector<Vector3i>& r_chunk_positions) const;
+
+	int64_t get_slot_count() const { return slots.size() - free_slots.size(); }
+
+private:
+	struct Slot
+	{
+		Vector3i chunk_pos{};
+		RID instance; // RenderingServer instance
+		RID body; // PhysicsServer3D static body
+		// Hold the resources so their RIDs stay valid
+		Ref<ArrayMesh> mesh;
+		Ref<ConcavePolygonShape3D> shape;
+	};
+
+	uint32_t get_or_create_slot(const Vector3i& p_chunk_pos);
+	const Slot* find_slot(const Vector3i& p_chunk_pos) const;
+	void free_slot_rids(Slot& p_slot);
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> free_slots;
+	std::unordered_map<Vector3i, uint32_t, Vector3iHasher> slot_indices;
+
+	RID scenario;
+	RID space;
+	RID material;
+};
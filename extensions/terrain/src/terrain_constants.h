@@ -13,6 +13,9 @@ constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
 constexpr int POINTS_SIZE = CHUNK_SIZE + 1;
 constexpr int POINTS_AREA = POINTS_SIZE * POINTS_SIZE;
 constexpr int POINTS_VOLUME = POINTS_SIZE * POINTS_SIZE * POINTS_SIZE;
+
+// Points at or above this density are solid. Must match isoLevel in ComputeCubes.glsl
+constexpr float ISO_LEVEL = 0.5f;
 } //namespace terrain_constants
 
 #endif
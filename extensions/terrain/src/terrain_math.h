@@ -0,0 +1,19 @@
+#pragma once
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+
+namespace terrain_math
+{
+// Integer division rounding towards negative infinity, p_divisor must be positive. Maps cells and chunks to the chunk or region containing them
+constexpr int32_t floor_div(int32_t p_value, int32_t p_divisor)
+{
+	return p_value >= 0 ? p_value / p_divisor : -((-p_value + p_divisor - 1) / p_divisor);
+}
+
+inline godot::Vector3i floor_div(const godot::Vector3i& p_value, int32_t p_divisor)
+{
+	return godot::Vector3i(floor_div(p_value.x, p_divisor), floor_div(p_value.y, p_divisor), floor_div(p_value.z, p_divisor));
+}
+} //namespace terrain_math
@@ -2,9 +2,11 @@
 
 #include "chunk_loader.h"
 #include "concurrent_chunk_map.h"
+#include "frame_budget.h"
 
 #include <godot_cpp/classes/performance.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/array.hpp>
 #include <godot_cpp/variant/callable.hpp>
 #include <godot_cpp/variant/variant.hpp>
 #include <godot_cpp/classes/time.hpp>
@@ -15,10 +17,23 @@
 
 constexpr const char* CHUNKS_ID = "Terrain/LoadedChunkCount";
 constexpr const char* CHUNKS_POOLED_ID = "Terrain/PooledChunkCount";
+constexpr const char* CHUNKS_COMMITTED_ID = "Terrain/CommittedChunkCount";
+constexpr const char* CHUNKS_RETIRED_ID = "Terrain/RetiredChunkCount";
 constexpr const char* CHUNKS_PS_ID = "Terrain/LoadedChunkCountPerSec";
 constexpr const char* MESH_TASKS_PS_ID = "Terrain/MeshTasksPerSec";
 constexpr const char* PENDING_CHUNKS_ID = "Terrain/PendingChunks";
 constexpr const char* DONE_MESH_DATAS_ID = "Terrain/DoneMeshDatas";
+constexpr const char* APPLY_BUDGET_ID = "Terrain/ApplyBudgetUsec";
+constexpr const char* CULLED_CHUNKS_ID = "Terrain/CulledChunks";
+constexpr const char* VIEWER_ANCHORS_ID = "Terrain/ViewerAnchors";
+constexpr const char* TIME_TO_VISIBLE_ID = "Terrain/LeadingEdgeTimeToVisibleMsec";
+// One per FrameBudget hitch bucket, frames counted since init
+constexpr const char* HITCH_IDS[FrameBudget::HITCH_BUCKET_COUNT] = {
+	"Terrain/Frames/OnTime",
+	"Terrain/Frames/Over1.25x",
+	"Terrain/Frames/Over2x",
+	"Terrain/Frames/Over4x",
+};
 
 TerrainPerformanceMonitor* TerrainPerformanceMonitor::singleton = nullptr;
 
@@ -31,10 +46,22 @@ void TerrainPerformanceMonitor::initialize()
 
 	performance->add_custom_monitor(CHUNKS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_chunks));
 	performance->add_custom_monitor(CHUNKS_POOLED_ID, callable_mp(this, &TerrainPerformanceMonitor::get_pooled_chunks));
+	performance->add_custom_monitor(CHUNKS_COMMITTED_ID, callable_mp(this, &TerrainPerformanceMonitor::get_committed_chunks));
+	performance->add_custom_monitor(CHUNKS_RETIRED_ID, callable_mp(this, &TerrainPerformanceMonitor::get_retired_chunks));
 	performance->add_custom_monitor(CHUNKS_PS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_chunks_ps));
 	performance->add_custom_monitor(MESH_TASKS_PS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_mesh_tasks_ps));
 	performance->add_custom_monitor(PENDING_CHUNKS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_pending_chunks_count));
 	performance->add_custom_monitor(DONE_MESH_DATAS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_done_mesh_data_count));
+	performance->add_custom_monitor(APPLY_BUDGET_ID, callable_mp(this, &TerrainPerformanceMonitor::get_apply_budget_usec));
+	performance->add_custom_monitor(CULLED_CHUNKS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_culled_chunks_count));
+	performance->add_custom_monitor(VIEWER_ANCHORS_ID, callable_mp(this, &TerrainPerformanceMonitor::get_viewer_anchor_count));
+	performance->add_custom_monitor(TIME_TO_VISIBLE_ID, callable_mp(this, &TerrainPerformanceMonitor::get_time_to_visible_msec));
+	for (int64_t i = 0; i < FrameBudget::HITCH_BUCKET_COUNT; ++i)
+	{
+		Array arguments;
+		arguments.push_back(i);
+		performance->add_custom_monitor(HITCH_IDS[i], callable_mp(this, &TerrainPerformanceMonitor::get_hitch_count), arguments);
+	}
 }
 
 void TerrainPerformanceMonitor::uninitialize()
@@ -44,10 +71,20 @@ void TerrainPerformanceMonitor::uninitialize()
 
 	performance->remove_custom_monitor(CHUNKS_ID);
 	performance->remove_custom_monitor(CHUNKS_POOLED_ID);
+	performance->remove_custom_monitor(CHUNKS_COMMITTED_ID);
+	performance->remove_custom_monitor(CHUNKS_RETIRED_ID);
 	performance->remove_custom_monitor(CHUNKS_PS_ID);
 	performance->remove_custom_monitor(MESH_TASKS_PS_ID);
 	performance->remove_custom_monitor(PENDING_CHUNKS_ID);
 	performance->remove_custom_monitor(DONE_MESH_DATAS_ID);
+	performance->remove_custom_monitor(APPLY_BUDGET_ID);
+	performance->remove_custom_monitor(CULLED_CHUNKS_ID);
+	performance->remove_custom_monitor(VIEWER_ANCHORS_ID);
+	performance->remove_custom_monitor(TIME_TO_VISIBLE_ID);
+	for (const char* hitch_id : HITCH_IDS)
+	{
+		performance->remove_custom_monitor(hitch_id);
+	}
 }
 
 void TerrainPerformanceMonitor::set_chunk_loader(ChunkLoader* p_chunk_loader)
@@ -77,6 +114,26 @@ int64_t TerrainPerformanceMonitor::get_pooled_chunks()
 	return chunk_map.lock()->get_pool_count();
 }
 
+int64_t TerrainPerformanceMonitor::get_committed_chunks()
+{
+	if (chunk_map.expired())
+	{
+		return 0;
+	}
+
+	return chunk_map.lock()->get_pool_capacity();
+}
+
+int64_t TerrainPerformanceMonitor::get_retired_chunks()
+{
+	if (chunk_map.expired())
+	{
+		return 0;
+	}
+
+	return chunk_map.lock()->get_retired_count();
+}
+
 float TerrainPerformanceMonitor::get_chunks_ps()
 {
 	uint64_t time = Time::get_singleton()->get_ticks_usec();
@@ -142,6 +199,31 @@ int64_t TerrainPerformanceMonitor::get_done_mesh_data_count()
 	return chunk_loader ? chunk_loader->get_mesh_datas_count() : 0;
 }
 
+int64_t TerrainPerformanceMonitor::get_apply_budget_usec()
+{
+	return chunk_loader ? chunk_loader->get_frame_budget().get_budget_usec() : 0;
+}
+
+int64_t TerrainPerformanceMonitor::get_culled_chunks_count()
+{
+	return chunk_loader ? chunk_loader->get_culled_chunks_count() : 0;
+}
+
+int64_t TerrainPerformanceMonitor::get_viewer_anchor_count()
+{
+	return chunk_loader ? chunk_loader->get_chunk_interest().get_anchor_count() : 0;
+}
+
+float TerrainPerformanceMonitor::get_time_to_visible_msec()
+{
+	return chunk_loader ? chunk_loader->get_time_to_visible_msec() : 0.0f;
+}
+
+int64_t TerrainPerformanceMonitor::get_hitch_count(int64_t p_bucket)
+{
+	return chunk_loader ? chunk_loader->get_frame_budget().get_hitch_count(p_bucket) : 0;
+}
+
 void TerrainPerformanceMonitor::_bind_methods()
 {
 }
@@ -26,11 +26,18 @@ public:
 
 	int64_t get_chunks();
 	int64_t get_pooled_chunks();
+	int64_t get_committed_chunks();
+	int64_t get_retired_chunks();
 	float get_chunks_ps();
 	float get_mesh_tasks_ps();
 	int64_t get_pending_chunks_count();
 	int64_t get_pending_mesh_tasks_count();
 	int64_t get_done_mesh_data_count();
+	int64_t get_apply_budget_usec();
+	int64_t get_hitch_count(int64_t p_bucket);
+	int64_t get_culled_chunks_count();
+	int64_t get_viewer_anchor_count();
+	float get_time_to_visible_msec();
 
 protected:
 	static void _bind_methods();
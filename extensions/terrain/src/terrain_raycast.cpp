@@ -0,0 +1,405 @@
+#include "terrain_raycast.h"
+
+#include "chunk_data.h"
+#include "concurrent_chunk_map.h"
+#include "height_range_oracle.h"
+#include "terrain_constants.h"
+#include "terrain_math.h"
+
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+using namespace godot;
+using namespace terrain_constants;
+using namespace terrain_math;
+
+namespace
+{
+constexpr float DENSITY_SCALE = 1.0f / 255.0f;
+constexpr int ROOT_SUBDIVISIONS = 4;
+constexpr int ROOT_BISECTIONS = 8;
+
+// Trilinear interpolation of the 8 points around p_index, p_fraction is the position inside the cell
+float trilinear(const uint8_t* p_points, int p_index, const Vector3& p_fraction)
+{
+	const float c000 = p_points[p_index];
+	const float c100 = p_points[p_index + 1];
+	const float c010 = p_points[p_index + POINTS_SIZE];
+	const float c110 = p_points[p_index + 1 + POINTS_SIZE];
+	const float c001 = p_points[p_index + POINTS_AREA];
+	const float c101 = p_points[p_index + 1 + POINTS_AREA];
+	const float c011 = p_points[p_index + POINTS_SIZE + POINTS_AREA];
+	const float c111 = p_points[p_index + 1 + POINTS_SIZE + POINTS_AREA];
+
+	const float x = p_fraction.x;
+	const float y = p_fraction.y;
+	const float z = p_fraction.z;
+
+	const float c00 = c000 + (c100 - c000) * x;
+	const float c10 = c010 + (c110 - c010) * x;
+	const float c01 = c001 + (c101 - c001) * x;
+	const float c11 = c011 + (c111 - c011) * x;
+
+	const float c0 = c00 + (c10 - c00) * y;
+	const float c1 = c01 + (c11 - c01) * y;
+
+	return (c0 + (c1 - c0) * z) * DENSITY_SCALE;
+}
+
+// Amanatides & Woo grid traversal
+struct GridTraversal
+{
+	Vector3i cell{};
+	Vector3i step{};
+	Vector3 t_max{};
+	Vector3 t_delta{};
+	int last_axis = -1;
+
+	GridTraversal(const Vector3& p_origin, const Vector3& p_direction, float p_cell_size, float p_t_start)
+	{
+		const Vector3 start = p_origin + p_direction * p_t_start;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cell[axis] = static_cast<int32_t>(Math::floor(start[axis] / p_cell_size));
+			if (p_direction[axis] > 0.0f)
+			{
+				step[axis] = 1;
+				t_max[axis] = p_t_start + ((cell[axis] + 1) * p_cell_size - start[axis]) / p_direction[axis];
+				t_delta[axis] = p_cell_size / p_direction[axis];
+			}
+			else if (p_direction[axis] < 0.0f)
+			{
+				step[axis] = -1;
+				t_max[axis] = p_t_start + (cell[axis] * p_cell_size - start[axis]) / p_direction[axis];
+				t_delta[axis] = -p_cell_size / p_direction[axis];
+			}
+			else
+			{
+				step[axis] = 0;
+				t_max[axis] = std::numeric_limits<float>::infinity();
+				t_delta[axis] = std::numeric_limits<float>::infinity();
+			}
+		}
+	}
+
+	int next_axis() const
+	{
+		if (t_max.x < t_max.y)
+		{
+			return t_max.x < t_max.z ? 0 : 2;
+		}
+		return t_max.y < t_max.z ? 1 : 2;
+	}
+
+	float next_t() const { return t_max[next_axis()]; }
+
+	void advance()
+	{
+		const int axis = next_axis();
+		cell[axis] += step[axis];
+		t_max[axis] += t_delta[axis];
+		last_axis = axis;
+	}
+};
+
+// Directions tested around a swept sphere, the 6 axes and 8 diagonals
+constexpr float DIAGONAL = 0.57735027f;
+const std::array<Vector3, 14> SPHERE_DIRECTIONS = {
+	Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1),
+	Vector3(DIAGONAL, DIAGONAL, DIAGONAL), Vector3(DIAGONAL, DIAGONAL, -DIAGONAL),
+	Vector3(DIAGONAL, -DIAGONAL, DIAGONAL), Vector3(DIAGONAL, -DIAGONAL, -DIAGONAL),
+	Vector3(-DIAGONAL, DIAGONAL, DIAGONAL), Vector3(-DIAGONAL, DIAGONAL, -DIAGONAL),
+	Vector3(-DIAGONAL, -DIAGONAL, DIAGONAL), Vector3(-DIAGONAL, -DIAGONAL, -DIAGONAL)
+};
+} //namespace
+
+TerrainRayHit TerrainRaycast::raycast(const Vector3& p_from, const Vector3& p_to)
+{
+	TerrainRayHit hit{};
+
+	const Vector3 delta = p_to - p_from;
+	const float length = delta.length();
+	if (length <= 0.0f)
+	{
+		return hit;
+	}
+	const Vector3 direction = delta / length;
+
+	// Walk the chunks first, so empty and unloaded chunks are skipped in one step
+	GridTraversal chunks(p_from, direction, static_cast<float>(CHUNK_SIZE), 0.0f);
+	float t_enter = 0.0f;
+	while (t_enter <= length)
+	{
+		const float t_exit = MIN(chunks.next_t(), length);
+
+		SurfaceState surface_state = SurfaceState::EMPTY;
+		const ChunkData* chunk = find_chunk(chunks.cell, surface_state);
+		if (surface_state == SurfaceState::FULL)
+		{
+			Vector3 normal = -direction;
+			if (chunks.last_axis >= 0)
+			{
+				normal = Vector3();
+				normal[chunks.last_axis] = static_cast<float>(-chunks.step[chunks.last_axis]);
+			}
+
+			hit.hit = true;
+			hit.distance = t_enter;
+			hit.position = p_from + direction * t_enter;
+			hit.normal = normal;
+			return hit;
+		}
+
+		if (surface_state == SurfaceState::MIXED && raycast_chunk(chunk, p_from, direction, t_enter, t_exit, hit))
+		{
+			return hit;
+		}
+
+		t_enter = chunks.next_t();
+		chunks.advance();
+	}
+
+	return hit;
+}
+
+bool TerrainRaycast::raycast_chunk(const ChunkData* p_chunk, const Vector3& p_from, const Vector3& p_direction, float p_t_enter, float p_t_exit, TerrainRayHit& r_hit)
+{
+	const Vector3i chunk_origin = p_chunk->position * CHUNK_SIZE;
+	const uint8_t* points = p_chunk->points.data();
+	constexpr float iso_level = ISO_LEVEL * 255.0f;
+
+	GridTraversal cells(p_from, p_direction, 1.0f, p_t_enter);
+	float t = p_t_enter;
+	while (t <= p_t_exit)
+	{
+		const float t_next = MIN(cells.next_t(), p_t_exit);
+		const Vector3i local = cells.cell - chunk_origin;
+
+		// Rounding at the chunk faces can put the first or last cell just outside the chunk
+		if (local.x >= 0 && local.y >= 0 && local.z >= 0 && local.x < CHUNK_SIZE && local.y < CHUNK_SIZE && local.z < CHUNK_SIZE)
+		{
+			const int index = local.x + local.y * POINTS_SIZE + local.z * POINTS_AREA;
+
+			uint8_t max_corner = points[index];
+			max_corner = MAX(max_corner, points[index + 1]);
+			max_corner = MAX(max_corner, points[index + POINTS_SIZE]);
+			max_corner = MAX(max_corner, points[index + 1 + POINTS_SIZE]);
+			max_corner = MAX(max_corner, points[index + POINTS_AREA]);
+			max_corner = MAX(max_corner, points[index + 1 + POINTS_AREA]);
+			max_corner = MAX(max_corner, points[index + POINTS_SIZE + POINTS_AREA]);
+			max_corner = MAX(max_corner, points[index + 1 + POINTS_SIZE + POINTS_AREA]);
+
+			if (max_corner >= iso_level)
+			{
+				const Vector3 cell_origin = Vector3(cells.cell);
+				auto density_at = [&](float p_t)
+				{
+					Vector3 fraction = p_from + p_direction * p_t - cell_origin;
+					fraction.x = CLAMP(fraction.x, 0.0f, 1.0f);
+					fraction.y = CLAMP(fraction.y, 0.0f, 1.0f);
+					fraction.z = CLAMP(fraction.z, 0.0f, 1.0f);
+					return trilinear(points, index, fraction);
+				};
+
+				float t_solid = -1.0f;
+				float t_air = t;
+				if (density_at(t) >= ISO_LEVEL)
+				{
+					t_solid = t; // Started inside the surface
+				}
+				else
+				{
+					// The field is cubic along the ray, so step through the cell to find the first crossing
+					for (int i = 1; i <= ROOT_SUBDIVISIONS; ++i)
+					{
+						const float t_sample = t + (t_next - t) * (static_cast<float>(i) / ROOT_SUBDIVISIONS);
+						if (density_at(t_sample) >= ISO_LEVEL)
+						{
+							t_solid = t_sample;
+							break;
+						}
+						t_air = t_sample;
+					}
+
+					if (t_solid >= 0.0f)
+					{
+						for (int i = 0; i < ROOT_BISECTIONS; ++i)
+						{
+							const float t_mid = (t_air + t_solid) * 0.5f;
+							if (density_at(t_mid) >= ISO_LEVEL)
+							{
+								t_solid = t_mid;
+							}
+							else
+							{
+								t_air = t_mid;
+							}
+						}
+					}
+				}
+
+				if (t_solid >= 0.0f)
+				{
+					r_hit.hit = true;
+					r_hit.distance = t_solid;
+					r_hit.position = p_from + p_direction * t_solid;
+					r_hit.normal = surface_normal(r_hit.position, -p_direction);
+					return true;
+				}
+			}
+		}
+
+		t = cells.next_t();
+		cells.advance();
+	}
+
+	return false;
+}
+
+TerrainRayHit TerrainRaycast::sphere_cast(const Vector3& p_from, const Vector3& p_to, float p_radius)
+{
+	if (p_radius <= 0.0f)
+	{
+		return raycast(p_from, p_to);
+	}
+
+	TerrainRayHit hit{};
+
+	const Vector3 delta = p_to - p_from;
+	const float length = delta.length();
+	const Vector3 direction = length > 0.0f ? delta / length : Vector3();
+
+	Vector3 contact{};
+	auto is_blocked = [&](float p_t)
+	{
+		const Vector3 centre = p_from + direction * p_t;
+		if (sample_density(centre) >= ISO_LEVEL)
+		{
+			contact = centre;
+			return true;
+		}
+		for (const Vector3& sphere_direction : SPHERE_DIRECTIONS)
+		{
+			const Vector3 point = centre + sphere_direction * p_radius;
+			if (sample_density(point) >= ISO_LEVEL)
+			{
+				contact = point;
+				return true;
+			}
+		}
+		return false;
+	};
+
+	auto set_hit = [&](float p_t)
+	{
+		hit.hit = true;
+		hit.distance = p_t;
+		hit.position = contact;
+		hit.normal = surface_normal(contact, -direction);
+	};
+
+	if (is_blocked(0.0f))
+	{
+		set_hit(0.0f);
+		return hit;
+	}
+
+	// Step less than the radius so thin features between steps are still found
+	const float step = CLAMP(p_radius * 0.5f, 0.05f, 1.0f);
+	float t_free = 0.0f;
+	while (t_free < length)
+	{
+		float t_blocked = MIN(t_free + step, length);
+		if (is_blocked(t_blocked))
+		{
+			for (int i = 0; i < ROOT_BISECTIONS; ++i)
+			{
+				const float t_mid = (t_free + t_blocked) * 0.5f;
+				if (is_blocked(t_mid))
+				{
+					t_blocked = t_mid;
+				}
+				else
+				{
+					t_free = t_mid;
+				}
+			}
+
+			is_blocked(t_blocked); // Update the contact for the final position
+			set_hit(t_blocked);
+			return hit;
+		}
+		t_free = t_blocked;
+	}
+
+	return hit;
+}
+
+float TerrainRaycast::sample_density(const Vector3& p_position)
+{
+	const Vector3 floored = p_position.floor();
+	const Vector3i cell = Vector3i(floored);
+	const Vector3i chunk_pos(floor_div(cell.x, CHUNK_SIZE), floor_div(cell.y, CHUNK_SIZE), floor_div(cell.z, CHUNK_SIZE));
+
+	SurfaceState surface_state = SurfaceState::EMPTY;
+	const ChunkData* chunk = find_chunk(chunk_pos, surface_state);
+	if (surface_state == SurfaceState::EMPTY)
+	{
+		return 0.0f;
+	}
+	if (surface_state == SurfaceState::FULL)
+	{
+		return 1.0f;
+	}
+
+	const Vector3i local = cell - chunk_pos * CHUNK_SIZE;
+	const int index = local.x + local.y * POINTS_SIZE + local.z * POINTS_AREA;
+	return trilinear(chunk->points.data(), index, p_position - floored);
+}
+
+const ChunkData* TerrainRaycast::find_chunk(const Vector3i& p_chunk_pos, SurfaceState& r_surface_state)
+{
+	if (has_cached_chunk && cached_chunk_pos == p_chunk_pos)
+	{
+		r_surface_state = cached_surface_state;
+		return cached_chunk;
+	}
+
+	// Chunks still being generated count as not loaded
+	cached_chunk = chunk_map ? chunk_map->get_generated_chunk(p_chunk_pos) : nullptr;
+	if (cached_chunk)
+	{
+		cached_surface_state = cached_chunk->surface_state;
+	}
+	else
+	{
+		// Deep rock is never loaded, only the oracle knows it's there
+		const bool is_rock = oracle && oracle->classify(p_chunk_pos) == SurfaceState::FULL;
+		cached_surface_state = is_rock ? SurfaceState::FULL : SurfaceState::EMPTY;
+	}
+	cached_chunk_pos = p_chunk_pos;
+	has_cached_chunk = true;
+	r_surface_state = cached_surface_state;
+	return cached_chunk;
+}
+
+Vector3 TerrainRaycast::surface_normal(const Vector3& p_position, const Vector3& p_fallback)
+{
+	// Density increases into the ground, so the normal points down the gradient
+	constexpr float h = 0.5f;
+	Vector3 gradient(
+			sample_density(p_position + Vector3(h, 0, 0)) - sample_density(p_position - Vector3(h, 0, 0)),
+			sample_density(p_position + Vector3(0, h, 0)) - sample_density(p_position - Vector3(0, h, 0)),
+			sample_density(p_position + Vector3(0, 0, h)) - sample_density(p_position - Vector3(0, 0, h)));
+
+	if (gradient.length_squared() <= 0.0f)
+	{
+		return p_fallback;
+	}
+	return -gradient.normalized();
+}
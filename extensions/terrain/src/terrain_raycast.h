@@ -0,0 +1,60 @@
+#pragma once
+
+#include "chunk_data.h"
+#include "concurrent_chunk_map.h"
+#include "epoch_manager.h"
+#include "height_range_oracle.h"
+
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+
+using namespace godot;
+
+struct TerrainRayHit
+{
+	bool hit = false;
+	float distance = 0.0f; // Distance travelled from the start of the ray
+	Vector3 position{};
+	Vector3 normal{};
+};
+
+/**
+ * @brief Ray and sphere queries directly against the chunk data, so no physics collision is needed
+ * Walks the chunks along the ray with a DDA, then walks the voxel cells of the surface chunks and finds the
+ * iso-surface crossing of the same trilinear field the mesher uses. Unloaded chunks are treated as air, unless the
+ * HeightRangeOracle says they're solid rock.
+ * Can be used from any thread, but each thread needs its own instance. An instance pins the chunk map for as long as
+ * it exists, so keep it to the queries at hand.
+ */
+class TerrainRaycast
+{
+public:
+	explicit TerrainRaycast(ConcurrentChunkMap* p_chunk_map, const HeightRangeOracle* p_oracle = nullptr) :
+			chunk_map(p_chunk_map), oracle(p_oracle), pin(p_chunk_map ? p_chunk_map->pin() : EpochManager::Pin{}) {}
+
+	TerrainRayHit raycast(const Vector3& p_from, const Vector3& p_to);
+
+	// Approximate sweep, the sphere is tested at its centre and 14 points on its surface
+	TerrainRayHit sphere_cast(const Vector3& p_from, const Vector3& p_to, float p_radius);
+
+	// Density in the 0-1 range at a world position, 0 when the chunk isn't loaded and isn't rock
+	float sample_density(const Vector3& p_position);
+
+private:
+	// r_surface_state is the chunk's state, or for an unloaded chunk FULL if it's rock and EMPTY otherwise
+	const ChunkData* find_chunk(const Vector3i& p_chunk_pos, SurfaceState& r_surface_state);
+	bool raycast_chunk(const ChunkData* p_chunk, const Vector3& p_from, const Vector3& p_direction, float p_t_enter, float p_t_exit, TerrainRayHit& r_hit);
+	Vector3 surface_normal(const Vector3& p_position, const Vector3& p_fallback);
+
+	ConcurrentChunkMap* chunk_map = nullptr;
+	const HeightRangeOracle* oracle = nullptr;
+	EpochManager::Pin pin{}; // The chunks it finds, and the cached one, aren't recycled under it
+
+	// Queries tend to stay in the same chunk, so keep the last lookup
+	Vector3i cached_chunk_pos{};
+	const ChunkData* cached_chunk = nullptr;
+	SurfaceState cached_surface_state = SurfaceState::EMPTY;
+	bool has_cached_chunk = false;
+};
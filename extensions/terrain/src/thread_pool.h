@@ -153,7 +153,7 @@ public:
 			return;
 		}
 
-		task_queue.push(TTask(task), prioritise);
+		task_queue.push(std::move(task), prioritise);
 	}
 
 	void queue_task(std::vector<TTask> tasks, bool prioritise = false)
@@ -164,7 +164,18 @@ public:
 			return;
 		}
 
-		task_queue.push(tasks, prioritise);
+		task_queue.push(std::move(tasks), prioritise);
+	}
+
+	// Drops queued tasks matching p_predicate, tasks a thread already took still run. Returns how many were dropped
+	template <typename TPredicate>
+	int64_t cancel_tasks(TPredicate p_predicate)
+	{
+		if (state.load() != ThreadPoolState::Ready)
+		{
+			return 0;
+		}
+		return task_queue.erase_if(p_predicate);
 	}
 
 	int64_t get_task_count() const
@@ -224,11 +235,11 @@ private:
 			if (!tasks_opt) break; // queue was cleared, stop processing
 
 			std::vector<TTask>& tasks = *tasks_opt;
-			for (TTask task : tasks)
+			for (TTask& task : tasks)
 			{
 				if (state.load(std::memory_order_relaxed) == ThreadPoolState::Ready)
 				{
-					local_results_buffer.push_back(processor_ptr->process_task(task));
+					local_results_buffer.push_back(processor_ptr->process_task(std::move(task)));
 				}
 			}
 
@@ -0,0 +1,165 @@
+#include "virtual_arena.h"
+
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+VirtualArena::VirtualArena(uint64_t p_size, uint64_t p_alignment)
+{
+	const uint64_t arena_size = round_up_to_page(p_size);
+	if (arena_size == 0)
+	{
+		return;
+	}
+	// Reserving the alignment over lets the base be moved up to it
+	const uint64_t padding = p_alignment > get_page_size() ? p_alignment : 0;
+	const uint64_t reserve_size = arena_size + padding;
+
+#ifdef _WIN32
+	void* ptr = VirtualAlloc(nullptr, reserve_size, MEM_RESERVE, PAGE_NOACCESS);
+	if (!ptr)
+	{
+		return;
+	}
+#else
+	// No access and no swap reserved, the range only holds addresses until parts of it are committed
+	void* ptr = mmap(nullptr, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (ptr == MAP_FAILED)
+	{
+		return;
+	}
+#endif
+
+	reservation = static_cast<uint8_t*>(ptr);
+	reservation_size = reserve_size;
+	base = reservation;
+	if (padding > 0)
+	{
+		const uintptr_t address = reinterpret_cast<uintptr_t>(reservation);
+		base += (p_alignment - address % p_alignment) % p_alignment;
+	}
+	size = arena_size;
+}
+
+VirtualArena::~VirtualArena()
+{
+	release();
+}
+
+VirtualArena::VirtualArena(VirtualArena&& p_other) noexcept :
+		base(std::exchange(p_other.base, nullptr)),
+		size(std::exchange(p_other.size, 0)),
+		reservation(std::exchange(p_other.reservation, nullptr)),
+		reservation_size(std::exchange(p_other.reservation_size, 0))
+{
+}
+
+VirtualArena& VirtualArena::operator=(VirtualArena&& p_other) noexcept
+{
+	if (this != &p_other)
+	{
+		release();
+		base = std::exchange(p_other.base, nullptr);
+		size = std::exchange(p_other.size, 0);
+		reservation = std::exchange(p_other.reservation, nullptr);
+		reservation_size = std::exchange(p_other.reservation_size, 0);
+	}
+	return *this;
+}
+
+bool VirtualArena::commit(uint64_t p_offset, uint64_t p_size)
+{
+	if (!base || p_offset + p_size > size)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return VirtualAlloc(base + p_offset, p_size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+	// Pages are only backed when they're first touched
+	return mprotect(base + p_offset, p_size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void VirtualArena::decommit(uint64_t p_offset, uint64_t p_size)
+{
+	if (!base || p_offset + p_size > size)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	VirtualFree(base + p_offset, p_size, MEM_DECOMMIT);
+#elif defined(__linux__)
+	// Dropping the pages in place keeps the mapping and its MADV_HUGEPAGE advice, mapping over them would lose it.
+	// The reservation is MAP_NORESERVE so there's no commit charge to give back
+	madvise(base + p_offset, p_size, MADV_DONTNEED);
+	mprotect(base + p_offset, p_size, PROT_NONE);
+#else
+	// Mapping over the pages drops them and their commit charge in one go, madvise alone keeps the charge
+	mmap(base + p_offset, p_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+}
+
+void VirtualArena::advise_huge_pages()
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if (base)
+	{
+		madvise(base, size, MADV_HUGEPAGE);
+	}
+#endif
+}
+
+uint64_t VirtualArena::get_page_size()
+{
+	static const uint64_t page_size = []()
+	{
+#ifdef _WIN32
+		// Reservations are aligned to the allocation granularity, keeping commits to it too keeps blocks aligned
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return static_cast<uint64_t>(info.dwAllocationGranularity);
+#else
+		return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}();
+	return page_size;
+}
+
+uint64_t VirtualArena::round_up_to_page(uint64_t p_size)
+{
+	const uint64_t page_size = get_page_size();
+	return (p_size + page_size - 1) / page_size * page_size;
+}
+
+void VirtualArena::release()
+{
+	if (!reservation)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	VirtualFree(reservation, 0, MEM_RELEASE);
+#else
+	munmap(reservation, reservation_size);
+#endif
+	base = nullptr;
+	size = 0;
+	reservation = nullptr;
+	reservation_size = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief A reserved range of virtual address space, committed to memory in parts on demand
+ * Reserving costs no memory, only the parts that are committed are backed by pages, and they can be decommitted to give
+ * the memory back while the addresses stay reserved. Nothing in the range moves, so pointers into it stay valid.
+ * Offsets and sizes passed to commit and decommit must be multiples of the page size.
+ * Not thread safe, the owner serialises commits and decommits.
+ */
+class VirtualArena
+{
+public:
+	VirtualArena() = default;
+	// Rounded up to a multiple of the page size. The base is aligned to p_alignment when it's bigger than a page, for
+	// huge pages. Check is_valid, the reservation can fail
+	explicit VirtualArena(uint64_t p_size, uint64_t p_alignment = 0);
+	~VirtualArena();
+
+	VirtualArena(const VirtualArena&) = delete;
+	VirtualArena& operator=(const VirtualArena&) = delete;
+	VirtualArena(VirtualArena&& p_other) noexcept;
+	VirtualArena& operator=(VirtualArena&& p_other) noexcept;
+
+	bool is_valid() const { return base != nullptr; }
+	uint8_t* get_base() const { return base; }
+	uint64_t get_size() const { return size; }
+	bool contains(const void* p_ptr) const
+	{
+		const uint8_t* ptr = static_cast<const uint8_t*>(p_ptr);
+		return ptr >= base && ptr < base + size;
+	}
+
+	// Committed memory reads as zero. Returns false when the system is out of memory
+	bool commit(uint64_t p_offset, uint64_t p_size);
+	// The memory goes back to the system, touching it again faults until it's committed again
+	void decommit(uint64_t p_offset, uint64_t p_size);
+
+	// Asks for transparent huge pages for the whole range, for arenas committed in 2MB steps or more.
+	// Only Linux has them, elsewhere it does nothing
+	void advise_huge_pages();
+
+	static constexpr uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	static uint64_t get_page_size();
+	static uint64_t round_up_to_page(uint64_t p_size);
+
+private:
+	void release();
+
+	uint8_t* base = nullptr;
+	uint64_t size = 0;
+	// The whole reservation, bigger than the range when the base was aligned
+	uint8_t* reservation = nullptr;
+	uint64_t reservation_size = 0;
+};
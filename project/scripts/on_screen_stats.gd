@@ -19,6 +19,11 @@ func _ready() -> void:
 	add_perf_monitor("Mesh Tasks", func() -> String: return "%.2f%%" % (100 * Performance.get_custom_monitor("Terrain/MeshTasksPerSec")))
 	add_perf_monitor("Pending Chunks", func() -> float: return Performance.get_custom_monitor("Terrain/PendingChunks"))
 	add_perf_monitor("Done Mesh Datas", func() -> float: return Performance.get_custom_monitor("Terrain/DoneMeshDatas"))
+	add_perf_monitor("Apply Budget", func() -> String: return "%.1f ms" % (Performance.get_custom_monitor("Terrain/ApplyBudgetUsec") / 1000))
+	add_perf_monitor("Hitches", func() -> String: return "%.0f / %.0f / %.0f" % [
+		Performance.get_custom_monitor("Terrain/Frames/Over1.25x"),
+		Performance.get_custom_monitor("Terrain/Frames/Over2x"),
+		Performance.get_custom_monitor("Terrain/Frames/Over4x")])
 
 func add_perf_monitor(display_name: String, getter_callable: Callable) -> void:
 	monitors[display_name] = getter_callable